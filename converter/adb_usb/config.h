@@ -51,6 +51,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define ADB_DATA_BIT    0
 //#define ADB_PSW_BIT     1       // optional
 
+/* ADB pin interrupt: any edge of Data line on INT0(PD0) */
+#ifdef ADB_USE_INT
+#define ADB_INT_INIT()  do {    \
+    EICRA &= ~(1<<ISC01);       \
+    EICRA |=  (1<<ISC00);       \
+} while (0)
+#define ADB_INT_ON()  do {      \
+    EIFR  |= (1<<INTF0);        \
+    EIMSK |= (1<<INT0);         \
+} while (0)
+#define ADB_INT_OFF() do {      \
+    EIMSK &= ~(1<<INT0);        \
+} while (0)
+#define ADB_INT_VECT    INT0_vect
+#endif
+
 /* key combination for command */
 #ifndef __ASSEMBLER__
 #include "adb.h"
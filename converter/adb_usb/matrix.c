@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "matrix.h"
 #include "report.h"
 #include "host.h"
+#include "timer.h"
 
 
 #if (MATRIX_COLS > 16)
@@ -77,6 +78,10 @@ void matrix_init(void)
     // upper byte: reserved bits 0000, device address 0010
     // lower byte: device handler 00000011
     adb_host_listen(0x2B,0x02,0x03);
+#ifdef ADB_USE_INT
+    // find keypad or another keyboard and mouse on bus
+    adb_host_enumerate();
+#endif
 
     // initialize matrix state: all keys off
     for (uint8_t i=0; i < MATRIX_ROWS; i++) matrix[i] = 0x00;
@@ -101,13 +106,25 @@ void adb_mouse_task(void)
     uint16_t codes;
     int16_t x, y;
     static int8_t mouseacc; 
+#ifdef ADB_USE_INT
+    static uint16_t mouse_time;
+#endif
+#ifndef ADB_USE_INT
     _delay_ms(12);  // delay for preventing overload of poor ADB keyboard controller
+#endif
     codes = adb_host_mouse_recv();
     // If nothing received reset mouse acceleration, and quit. 
     if (!codes) {
+#ifdef ADB_USE_INT
+        // polled in background, reset only when a poll has got nothing
+        if (timer_elapsed(mouse_time) > ADB_POLL_INTERVAL * 2)
+#endif
         mouseacc = 1;
         return;
     };
+#ifdef ADB_USE_INT
+    mouse_time = timer_read();
+#endif
     // Bit sixteen is button.
     if (~codes & (1 << 15))
         mouse_report.buttons |= MOUSE_BTN1;
@@ -166,7 +183,9 @@ uint8_t matrix_scan(void)
 
     if ( codes == 0xFFFF )
     {
+#ifndef ADB_USE_INT
         _delay_ms(12);  // delay for preventing overload of poor ADB keyboard controller
+#endif
         codes = adb_host_kbd_recv();
     }
     key0 = codes>>8;
@@ -181,6 +181,38 @@ POSSIBILITY OF SUCH DAMAGE.
 #endif
 //================= End of TMK converter Configuration ==================
 
+/* NeXT pin interrupt: any edge of Keyboard Out line */
+#ifdef NEXT_USE_INT
+#ifdef TEENSY_CONFIG
+/* PCINT0(PB0) */
+#define NEXT_KBD_INT_INIT()  do {   \
+    PCMSK0 |= (1<<PCINT0);          \
+} while (0)
+#define NEXT_KBD_INT_ON()  do {     \
+    PCIFR  |= (1<<PCIF0);           \
+    PCICR  |= (1<<PCIE0);           \
+} while (0)
+#define NEXT_KBD_INT_OFF() do {     \
+    PCICR  &= ~(1<<PCIE0);          \
+} while (0)
+#define NEXT_KBD_INT_VECT   PCINT0_vect
+#else
+/* INT0(PD0) */
+#define NEXT_KBD_INT_INIT()  do {   \
+    EICRA &= ~(1<<ISC01);           \
+    EICRA |=  (1<<ISC00);           \
+} while (0)
+#define NEXT_KBD_INT_ON()  do {     \
+    EIFR  |= (1<<INTF0);            \
+    EIMSK |= (1<<INT0);             \
+} while (0)
+#define NEXT_KBD_INT_OFF() do {     \
+    EIMSK &= ~(1<<INT0);            \
+} while (0)
+#define NEXT_KBD_INT_VECT   INT0_vect
+#endif
+#endif
+
 /* key combination for command */
 #define IS_COMMAND() ( \
     (keyboard_report->mods == (MOD_BIT(KC_LSHIFT) | MOD_BIT(KC_RSHIFT)))|| \
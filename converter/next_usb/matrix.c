@@ -56,6 +56,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "debug.h"
 #include "matrix.h"
 #include "next_kbd.h"
+#include "timer.h"
 
 static void matrix_make(uint8_t code);
 static void matrix_break(uint8_t code);
@@ -92,6 +93,12 @@ uint8_t matrix_cols(void)
 
 static bool power_state = false;
 
+#if defined(NEXT_USE_INT) && defined(NEXT_KBD_INIT_FLASH_LEDS)
+// LEDs are flashed in background of scan
+static uint8_t flash_step = 0;
+static uint16_t flash_time;
+#endif
+
 /* intialize matrix for scanning. should be called once. */
 void matrix_init(void)
 {
@@ -119,6 +126,9 @@ void matrix_init(void)
     for (uint8_t i=0; i < MATRIX_ROWS; i++) matrix[i] = 0x00;
 
 #ifdef NEXT_KBD_INIT_FLASH_LEDS
+#ifdef NEXT_USE_INT
+    flash_time = timer_read();
+#else
     dprintf("flashing LEDs:");
     // flash the LEDs after initialization
     bool leds_on = true;
@@ -130,6 +140,7 @@ void matrix_init(void)
         _delay_ms(250);
     }
     dprintf("\n");
+#endif
 #endif
 
     dprintf("[ NeXT keyboard initialized ]\n");
@@ -160,7 +171,18 @@ void matrix_init(void)
 /* scan all key states on matrix */
 uint8_t matrix_scan(void)
 {
+#ifndef NEXT_USE_INT
     _delay_ms(20);
+#endif
+
+#if defined(NEXT_USE_INT) && defined(NEXT_KBD_INIT_FLASH_LEDS)
+    if (flash_step <= 6 && timer_elapsed(flash_time) >= 250) {
+        // off at even steps, on at odd ones, as busy wait version
+        next_kbd_set_leds(flash_step & 1, flash_step & 1);
+        flash_step++;
+        flash_time = timer_read();
+    }
+#endif
     
     //next_kbd_set_leds(false, false);
     NEXT_KBD_LED1_OFF;
@@ -191,6 +213,10 @@ uint8_t matrix_scan(void)
     {
         return 0;
     }
+#ifdef NEXT_USE_INT
+    // nothing queued
+    if (!resp) return 0;
+#endif
     
     NEXT_KBD_LED1_ON;
     
@@ -19,10 +19,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 
 /* translates key to keycode */
+#ifndef KEYMAP_PACKED_ENABLE
 uint8_t keymap_key_to_keycode(uint8_t layer, keypos_t key)
 {
     return pgm_read_byte(&keymaps[(layer)][(key.row)][(key.col)]);
 }
+#endif
 
 /* translates Fn keycode to action */
 action_t keymap_fn_to_action(uint8_t keycode)
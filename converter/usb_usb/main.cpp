@@ -89,6 +89,7 @@ int main(void)
     debug_enable = true;
     debug_keyboard = true;
 
+    keyboard_setup();
     host_set_driver(&lufa_driver);
     keyboard_init();
 
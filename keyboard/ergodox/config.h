@@ -49,13 +49,17 @@ Project located at <https://github.com/benblazak/ergodox-firmware>
  * This constant define not debouncing time in msecs, but amount of matrix
  * scan loops which should be made to get stable debounced results.
  *
- * On Ergodox matrix scan rate is relatively low, because of slow I2C.
- * Now it's only 317 scans/second, or about 3.15 msec/scan.
- * According to Cherry specs, debouncing time is 5 msec.
+ * On Ergodox matrix scan rate is limited by I2C to the left half. All its
+ * rows are read in one transfer in background while the right half is
+ * scanned, which takes about 0.8 msec of bus time per scan, compared to
+ * about 1.8 msec with a transaction for each row select, read and unselect.
+ * Check with DEBUG_MATRIX_SCAN_RATE below.
+ * According to Cherry specs, debouncing time is 5 msec. Each scan while
+ * debouncing adds 1 msec delay.
  *
- * And so, there is no sense to have DEBOUNCE higher than 2.
+ * And so, there is no sense to have DEBOUNCE higher than 3.
  */
-#define DEBOUNCE        2
+#define DEBOUNCE        3
 #define TAPPING_TERM    230
 
 /* Mechanical locking support. Use KC_LCAP, KC_LNUM or KC_LSCR instead in keymap */
@@ -174,5 +174,58 @@ extern unsigned char i2c_read(unsigned char ack);
 #define i2c_read(ack)  (ack) ? i2c_readAck() : i2c_readNak(); 
 
 
+/**
+ @brief Operations of transfer run by i2c_async_start()
+
+ I2C_OP_START is followed by address and direction, I2C_OP_WRITE by data byte.
+ First operation is I2C_OP_START, repeated start is another I2C_OP_START.
+ I2C_OP_END issues stop condition.
+ */
+#define I2C_OP_END      0
+#define I2C_OP_START    1
+#define I2C_OP_WRITE    2
+#define I2C_OP_READ_ACK 3
+#define I2C_OP_READ_NAK 4
+
+
+/**
+ @brief Starts transfer of operation list in background, driven by TWI interrupt
+
+ Bytes read are stored to rx in order. ops and rx must be kept until transfer
+ ends and other functions of this library must not be called meanwhile.
+ @param    ops operation list terminated by I2C_OP_END
+ @param    rx  buffer for bytes read
+ @return   none
+ */
+extern void i2c_async_start(const uint8_t *ops, uint8_t *rx);
+
+
+/**
+ @brief Checks if transfer started by i2c_async_start() is in progress
+ @retval   0 bus is released
+ @retval   1 transfer in progress
+ */
+extern unsigned char i2c_async_busy(void);
+
+
+/**
+ @brief Result of last transfer started by i2c_async_start()
+ @retval   0 all operations succeeded
+ @return   TWI status which aborted transfer, TW_NO_INFO by i2c_async_abort()
+ */
+extern unsigned char i2c_async_status(void);
+
+
+/**
+ @brief Aborts transfer in progress and resets TWI
+
+ For device holding the bus, like half unplugged cable. TWI is enabled again
+ by next transfer.
+ @param    void
+ @return   none
+ */
+extern void i2c_async_abort(void);
+
+
 /**@}*/
 #endif
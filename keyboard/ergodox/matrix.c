@@ -29,9 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "matrix.h"
 #include "ergodox.h"
 #include "i2cmaster.h"
-#ifdef DEBUG_MATRIX_SCAN_RATE
-#include  "timer.h"
-#endif
+#include "timer.h"
 
 #ifndef DEBOUNCE
 #   define DEBOUNCE	5
@@ -46,8 +44,12 @@ static matrix_row_t read_cols(uint8_t row);
 static void init_cols(void);
 static void unselect_rows();
 static void select_row(uint8_t row);
+static void left_scan_start(void);
+static void left_probe_start(void);
+static void left_scan_end(void);
 
-static uint8_t mcp23018_reset_loop;
+/* rows read in this scan */
+static matrix_row_t rows[MATRIX_ROWS];
 
 #ifdef DEBUG_MATRIX_SCAN_RATE
 uint32_t matrix_timer;
@@ -89,21 +91,6 @@ void matrix_init(void)
 
 uint8_t matrix_scan(void)
 {
-    if (mcp23018_status) { // if there was an error
-        if (++mcp23018_reset_loop == 0) {
-            // since mcp23018_reset_loop is 8 bit - we'll try to reset once in 255 matrix scans
-            // this will be approx bit more frequent than once per second
-            print("trying to reset mcp23018\n");
-            mcp23018_status = init_mcp23018();
-            if (mcp23018_status) {
-                print("left side not responding\n");
-            } else {
-                print("left side attached\n");
-                ergodox_blink_all_leds();
-            }
-        }
-    }
-
 #ifdef DEBUG_MATRIX_SCAN_RATE
     matrix_scan_count++;
 
@@ -166,9 +153,21 @@ uint8_t matrix_scan(void)
     mcp23018_status = ergodox_left_leds_update();
 #endif
 
-    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+    // left half is read over I2C in background while right half is scanned
+    if (!mcp23018_status) {
+        left_scan_start();
+    } else {
+        left_probe_start();
+    }
+    for (uint8_t i = 7; i < MATRIX_ROWS; i++) {
         select_row(i);
-        matrix_row_t cols = read_cols(i);
+        rows[i] = read_cols(i);
+        unselect_rows();
+    }
+    left_scan_end();
+
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+        matrix_row_t cols = rows[i];
         if (matrix_debouncing[i] != cols) {
             matrix_debouncing[i] = cols;
             if (debouncing) {
@@ -176,7 +175,6 @@ uint8_t matrix_scan(void)
             }
             debouncing = DEBOUNCE;
         }
-        unselect_rows();
     }
 
     if (debouncing) {
@@ -252,30 +250,132 @@ static void  init_cols(void)
 
 static matrix_row_t read_cols(uint8_t row)
 {
-    if (row < 7) {
-        if (mcp23018_status) { // if there was an error
-            return 0;
+    _delay_us(30);  // without this wait read unstable value.
+    // read from teensy
+    return
+        (PINF&(1<<0) ? 0 : (1<<0)) |
+        (PINF&(1<<1) ? 0 : (1<<1)) |
+        (PINF&(1<<4) ? 0 : (1<<2)) |
+        (PINF&(1<<5) ? 0 : (1<<3)) |
+        (PINF&(1<<6) ? 0 : (1<<4)) |
+        (PINF&(1<<7) ? 0 : (1<<5)) ;
+}
+
+/* Left half scan
+ *
+ * All rows of MCP23018 are read in one I2C transfer: each row is selected by
+ * writing GPIOA and, with address pointer advanced to GPIOB, read after
+ * repeated start without stop condition in between. Last write unselects
+ * all rows. It is run by TWI interrupt while rows of teensy are scanned.
+ */
+#define LEFT_ROWS       7
+#define LEFT_ROW_OPS    9
+
+static uint8_t left_ops[LEFT_ROWS*LEFT_ROW_OPS + 7];
+static uint8_t left_cols[LEFT_ROWS];
+
+static void left_scan_start(void)
+{
+    uint8_t led = ~(ergodox_left_led_3<<LEFT_LED_3_SHIFT);
+    uint8_t *op = left_ops;
+
+    for (uint8_t row = 0; row < LEFT_ROWS; row++) {
+        *op++ = I2C_OP_START;   *op++ = I2C_ADDR_WRITE;
+        *op++ = I2C_OP_WRITE;   *op++ = GPIOA;
+        *op++ = I2C_OP_WRITE;   *op++ = 0xFF & ~(1<<row) & led;
+        *op++ = I2C_OP_START;   *op++ = I2C_ADDR_READ;
+        *op++ = I2C_OP_READ_NAK;
+    }
+    *op++ = I2C_OP_START;   *op++ = I2C_ADDR_WRITE;
+    *op++ = I2C_OP_WRITE;   *op++ = GPIOA;
+    *op++ = I2C_OP_WRITE;   *op++ = 0xFF & led;
+    *op++ = I2C_OP_END;
+
+    i2c_async_start(left_ops, left_cols);
+}
+
+/* Left half link
+ *
+ * While MCP23018 doesn't respond it is probed with its init sequence, in
+ * background of right half scan like left half scan. Interval of probes
+ * doubles from MCP23018_PROBE_MIN up to MCP23018_PROBE_MAX ms, left half is
+ * scanned from next scan after a probe succeeds. Transfer not finished in
+ * LEFT_TIMEOUT ms(bus held by half unplugged cable) is aborted.
+ */
+#ifndef MCP23018_PROBE_MIN
+#   define MCP23018_PROBE_MIN   8
+#endif
+#ifndef MCP23018_PROBE_MAX
+#   define MCP23018_PROBE_MAX   128
+#endif
+#define LEFT_TIMEOUT    3
+
+static bool probing = false;
+static uint16_t probe_time;
+static uint16_t probe_interval = MCP23018_PROBE_MIN;
+
+static void left_probe_start(void)
+{
+    if (timer_elapsed(probe_time) < probe_interval) return;
+
+    uint8_t *op = left_ops;
+    // pin direction: rows are outputs, cols and LEDs of port B inputs
+    *op++ = I2C_OP_START;   *op++ = I2C_ADDR_WRITE;
+    *op++ = I2C_OP_WRITE;   *op++ = IODIRA;
+    *op++ = I2C_OP_WRITE;   *op++ = 0b00000000;
+    *op++ = I2C_OP_WRITE;   *op++ = 0b00111111;
+    // pull-up on inputs
+    *op++ = I2C_OP_START;   *op++ = I2C_ADDR_WRITE;
+    *op++ = I2C_OP_WRITE;   *op++ = GPPUA;
+    *op++ = I2C_OP_WRITE;   *op++ = 0b00000000;
+    *op++ = I2C_OP_WRITE;   *op++ = 0b00111111;
+    // rows unselected and LEDs
+    *op++ = I2C_OP_START;   *op++ = I2C_ADDR_WRITE;
+    *op++ = I2C_OP_WRITE;   *op++ = OLATA;
+    *op++ = I2C_OP_WRITE;   *op++ = 0xFF & ~(ergodox_left_led_3<<LEFT_LED_3_SHIFT);
+    *op++ = I2C_OP_WRITE;   *op++ = 0xFF & ~(ergodox_left_led_2<<LEFT_LED_2_SHIFT)
+                                         & ~(ergodox_left_led_1<<LEFT_LED_1_SHIFT);
+    *op++ = I2C_OP_END;
+
+    probing = true;
+    i2c_async_start(left_ops, left_cols);
+}
+
+static void left_scan_end(void)
+{
+    bool scanned = !mcp23018_status && !probing;
+
+    if (!mcp23018_status || probing) {
+        uint16_t start = timer_read();
+        while (i2c_async_busy()) {
+            if (timer_elapsed(start) > LEFT_TIMEOUT) {
+                i2c_async_abort();
+            }
+        }
+    }
+
+    if (probing) {
+        probing = false;
+        probe_time = timer_read();
+        if (i2c_async_status()) {
+            if (probe_interval < MCP23018_PROBE_MAX) {
+                probe_interval <<= 1;
+            }
         } else {
-            uint8_t data = 0;
-            mcp23018_status = i2c_start(I2C_ADDR_WRITE);    if (mcp23018_status) goto out;
-            mcp23018_status = i2c_write(GPIOB);             if (mcp23018_status) goto out;
-            mcp23018_status = i2c_start(I2C_ADDR_READ);     if (mcp23018_status) goto out;
-            data = i2c_readNak();
-            data = ~data;
-        out:
-            i2c_stop();
-            return data;
+            print("left side attached\n");
+            mcp23018_status = 0;
+            probe_interval = MCP23018_PROBE_MIN;
+        }
+    } else if (!mcp23018_status) {
+        mcp23018_status = i2c_async_status();
+        if (mcp23018_status) {
+            print("left side not responding\n");
+            probe_time = timer_read();
         }
-    } else {
-        _delay_us(30);  // without this wait read unstable value.
-        // read from teensy
-        return
-            (PINF&(1<<0) ? 0 : (1<<0)) |
-            (PINF&(1<<1) ? 0 : (1<<1)) |
-            (PINF&(1<<4) ? 0 : (1<<2)) |
-            (PINF&(1<<5) ? 0 : (1<<3)) |
-            (PINF&(1<<6) ? 0 : (1<<4)) |
-            (PINF&(1<<7) ? 0 : (1<<5)) ;
+    }
+
+    for (uint8_t row = 0; row < LEFT_ROWS; row++) {
+        rows[row] = (scanned && !mcp23018_status ? (uint8_t)~left_cols[row] : 0);
     }
 }
 
@@ -291,20 +391,6 @@ static matrix_row_t read_cols(uint8_t row)
  */
 static void unselect_rows(void)
 {
-    // unselect on mcp23018
-    if (mcp23018_status) { // if there was an error
-        // do nothing
-    } else {
-        // set all rows hi-Z : 1
-        mcp23018_status = i2c_start(I2C_ADDR_WRITE);    if (mcp23018_status) goto out;
-        mcp23018_status = i2c_write(GPIOA);             if (mcp23018_status) goto out;
-        mcp23018_status = i2c_write( 0xFF
-                              & ~(ergodox_left_led_3<<LEFT_LED_3_SHIFT)
-                          );                            if (mcp23018_status) goto out;
-    out:
-        i2c_stop();
-    }
-
     // unselect on teensy
     // Hi-Z(DDR:0, PORT:0) to unselect
     DDRB  &= ~(1<<0 | 1<<1 | 1<<2 | 1<<3);
@@ -317,54 +403,37 @@ static void unselect_rows(void)
 
 static void select_row(uint8_t row)
 {
-    if (row < 7) {
-        // select on mcp23018
-        if (mcp23018_status) { // if there was an error
-            // do nothing
-        } else {
-            // set active row low  : 0
-            // set other rows hi-Z : 1
-            mcp23018_status = i2c_start(I2C_ADDR_WRITE);        if (mcp23018_status) goto out;
-            mcp23018_status = i2c_write(GPIOA);                 if (mcp23018_status) goto out;
-            mcp23018_status = i2c_write( 0xFF & ~(1<<row) 
-                                  & ~(ergodox_left_led_3<<LEFT_LED_3_SHIFT)
-                              );                                if (mcp23018_status) goto out;
-        out:
-            i2c_stop();
-        }
-    } else {
-        // select on teensy
-        // Output low(DDR:1, PORT:0) to select
-        switch (row) {
-            case 7:
-                DDRB  |= (1<<0);
-                PORTB &= ~(1<<0);
-                break;
-            case 8:
-                DDRB  |= (1<<1);
-                PORTB &= ~(1<<1);
-                break;
-            case 9:
-                DDRB  |= (1<<2);
-                PORTB &= ~(1<<2);
-                break;
-            case 10:
-                DDRB  |= (1<<3);
-                PORTB &= ~(1<<3);
-                break;
-            case 11:
-                DDRD  |= (1<<2);
-                PORTD &= ~(1<<3);
-                break;
-            case 12:
-                DDRD  |= (1<<3);
-                PORTD &= ~(1<<3);
-                break;
-            case 13:
-                DDRC  |= (1<<6);
-                PORTC &= ~(1<<6);
-                break;
-        }
+    // select on teensy
+    // Output low(DDR:1, PORT:0) to select
+    switch (row) {
+        case 7:
+            DDRB  |= (1<<0);
+            PORTB &= ~(1<<0);
+            break;
+        case 8:
+            DDRB  |= (1<<1);
+            PORTB &= ~(1<<1);
+            break;
+        case 9:
+            DDRB  |= (1<<2);
+            PORTB &= ~(1<<2);
+            break;
+        case 10:
+            DDRB  |= (1<<3);
+            PORTB &= ~(1<<3);
+            break;
+        case 11:
+            DDRD  |= (1<<2);
+            PORTD &= ~(1<<3);
+            break;
+        case 12:
+            DDRD  |= (1<<3);
+            PORTD &= ~(1<<3);
+            break;
+        case 13:
+            DDRC  |= (1<<6);
+            PORTC &= ~(1<<6);
+            break;
     }
 }
 
@@ -7,6 +7,7 @@
 * Usage:    API compatible with I2C Software Library i2cmaster.h
 **************************************************************************/
 #include <inttypes.h>
+#include <avr/interrupt.h>
 #include <compat/twi.h>
 
 #include <i2cmaster.h>
@@ -206,3 +207,100 @@ unsigned char i2c_readNak(void)
     return TWDR;
 
 }/* i2c_readNak */
+
+
+/*************************************************************************
+ Transfer in background
+
+ Each TWI interrupt checks status of the step done and starts next operation,
+ so CPU is free while a byte is on the bus. Any unexpected status, like NACK
+ from a missing device, issues stop condition and aborts the transfer.
+*************************************************************************/
+static const uint8_t *async_ops;
+static uint8_t *async_rx;
+static volatile uint8_t async_busy = 0;
+static volatile uint8_t async_status = 0;
+
+static void async_next(void)
+{
+    switch (*async_ops++) {
+        case I2C_OP_START:
+            TWCR = (1<<TWINT) | (1<<TWSTA) | (1<<TWEN) | (1<<TWIE);
+            break;
+        case I2C_OP_WRITE:
+            TWDR = *async_ops++;
+            TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWIE);
+            break;
+        case I2C_OP_READ_ACK:
+            TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWEA) | (1<<TWIE);
+            break;
+        case I2C_OP_READ_NAK:
+            TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWIE);
+            break;
+        case I2C_OP_END:
+        default:
+            TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWSTO);
+            async_busy = 0;
+            break;
+    }
+}
+
+void i2c_async_start(const uint8_t *ops, uint8_t *rx)
+{
+    // previous stop condition may be still on the bus
+    while (TWCR & (1<<TWSTO));
+
+    async_ops = ops;
+    async_rx = rx;
+    async_status = 0;
+    async_busy = 1;
+    async_next();
+}/* i2c_async_start */
+
+unsigned char i2c_async_busy(void)
+{
+    return async_busy || (TWCR & (1<<TWSTO));
+}/* i2c_async_busy */
+
+unsigned char i2c_async_status(void)
+{
+    return async_status;
+}/* i2c_async_status */
+
+void i2c_async_abort(void)
+{
+    // disabling TWI releases SDA and SCL, stop condition may never finish
+    TWCR = 0;
+    if (async_busy) {
+        async_status = TW_NO_INFO;
+        async_busy = 0;
+    }
+}/* i2c_async_abort */
+
+ISR(TWI_vect)
+{
+    uint8_t twst = TW_STATUS & 0xF8;
+
+    switch (twst) {
+        case TW_START:
+        case TW_REP_START:
+            // address follows I2C_OP_START
+            TWDR = *async_ops++;
+            TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWIE);
+            return;
+        case TW_MT_SLA_ACK:
+        case TW_MR_SLA_ACK:
+        case TW_MT_DATA_ACK:
+            break;
+        case TW_MR_DATA_ACK:
+        case TW_MR_DATA_NACK:
+            *async_rx++ = TWDR;
+            break;
+        default:
+            async_status = twst;
+            TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWSTO);
+            async_busy = 0;
+            return;
+    }
+    async_next();
+}
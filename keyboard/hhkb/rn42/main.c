@@ -51,6 +51,7 @@ int main(void)  __attribute__ ((weak));
 int main(void)
 {
     SetupHardware();
+    keyboard_setup();
     sei();
 
     /* wait for USB startup to get ready for debug output */
@@ -231,7 +231,7 @@ host_driver_t rn42_config_driver = {
 };
 
 static uint8_t config_keyboard_leds(void) { return leds; }
-static void config_send_keyboard(report_keyboard_t *report) {}
-static void config_send_mouse(report_mouse_t *report) {}
+static void config_send_keyboard(report_keyboard_t *report) { host_keyboard_unsent(); }
+static void config_send_mouse(report_mouse_t *report) { host_mouse_unsent(); }
 static void config_send_system(uint16_t data) {}
 static void config_send_consumer(uint16_t data) {}
@@ -18,6 +18,7 @@ int main() {
 
     uint16_t t = 0;
 
+    keyboard_setup();
     host_set_driver(&mbed_driver);
     keyboard_init();
 
@@ -0,0 +1,103 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "keycode.h"
+#include "action.h"
+#include "action_macro.h"
+#include "report.h"
+#include "host.h"
+#include "print.h"
+#include "debug.h"
+#include "keymap.h"
+#include "progmem.h"
+
+
+#define KEYMAP( \
+    K00, K01, K02, K03, K04, K05, K06, K07, \
+    K10, K11, K12, K13, K14, K15, K16, K17, \
+    K20, K21, K22, K23, K24, K25, K26, K27, \
+    K30, K31, K32, K33, K34, K35, K36, K37, \
+    K40, K41, K42, K43, K44, K45, K46, K47, \
+    K50, K51, K52, K53, K54, K55, K56, K57, \
+    K60, K61, K62, K63, K64, K65, K66, K67, \
+    K70, K71, K72, K73, K74, K75, K76, K77  \
+) { \
+    { KC_##K00, KC_##K01, KC_##K02, KC_##K03, KC_##K04, KC_##K05, KC_##K06, KC_##K07 }, \
+    { KC_##K10, KC_##K11, KC_##K12, KC_##K13, KC_##K14, KC_##K15, KC_##K16, KC_##K17 }, \
+    { KC_##K20, KC_##K21, KC_##K22, KC_##K23, KC_##K24, KC_##K25, KC_##K26, KC_##K27 }, \
+    { KC_##K30, KC_##K31, KC_##K32, KC_##K33, KC_##K34, KC_##K35, KC_##K36, KC_##K37 }, \
+    { KC_##K40, KC_##K41, KC_##K42, KC_##K43, KC_##K44, KC_##K45, KC_##K46, KC_##K47 }, \
+    { KC_##K50, KC_##K51, KC_##K52, KC_##K53, KC_##K54, KC_##K55, KC_##K56, KC_##K57 }, \
+    { KC_##K60, KC_##K61, KC_##K62, KC_##K63, KC_##K64, KC_##K65, KC_##K66, KC_##K67 }, \
+    { KC_##K70, KC_##K71, KC_##K72, KC_##K73, KC_##K74, KC_##K75, KC_##K76, KC_##K77 }  \
+}
+
+#define KEYMAP_TRNS() KEYMAP( \
+    TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS, \
+    TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS, \
+    TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS, \
+    TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS, \
+    TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS, \
+    TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS, \
+    TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS, \
+    TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS)
+
+
+/*
+ * Layers above 1 are transparent so that lookup falls through all active
+ * layers down to layer 0, which is worst case for layer_switch_get_action().
+ */
+const uint8_t keymaps[][MATRIX_ROWS][MATRIX_COLS] PROGMEM = {
+    /* 0: default */
+    KEYMAP(ESC, 1,   2,   3,   4,   5,   6,   BSPC, \
+           TAB, Q,   W,   E,   R,   T,   Y,   U,    \
+           CAPS,A,   S,   D,   F,   G,   H,   J,    \
+           LSFT,Z,   X,   C,   V,   B,   N,   M,    \
+           I,   O,   P,   K,   L,   SCLN,QUOT,ENT,  \
+           7,   8,   9,   0,   MINS,EQL, COMM,DOT,  \
+           LEFT,DOWN,UP,  RGHT,SLSH,BSLS,GRV, RSFT, \
+           LCTL,LGUI,LALT,FN0, RALT,RGUI,FN1, RCTL),
+    /* 1: function */
+    KEYMAP(GRV, F1,  F2,  F3,  F4,  F5,  F6,  DEL,  \
+           TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,PGUP, \
+           TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,LEFT,DOWN, \
+           TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,PGDN, \
+           UP,  RGHT,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS, \
+           F7,  F8,  F9,  F10, F11, F12, TRNS,TRNS, \
+           HOME,PGDN,PGUP,END, TRNS,TRNS,TRNS,TRNS, \
+           TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS),
+    /* 2-15: transparent */
+    KEYMAP_TRNS(), KEYMAP_TRNS(), KEYMAP_TRNS(), KEYMAP_TRNS(), KEYMAP_TRNS(),
+    KEYMAP_TRNS(), KEYMAP_TRNS(), KEYMAP_TRNS(), KEYMAP_TRNS(), KEYMAP_TRNS(),
+    KEYMAP_TRNS(), KEYMAP_TRNS(), KEYMAP_TRNS(), KEYMAP_TRNS(),
+};
+
+const uint16_t fn_actions[] PROGMEM = {
+    [0] = ACTION_LAYER_TAP_KEY(1, KC_SPC),
+    [1] = ACTION_MACRO(0),
+};
+
+/* types while keys are scanned, see trace/macro.txt */
+const macro_t *action_get_macro(keyrecord_t *record, uint8_t id, uint8_t opt)
+{
+    if (!record->event.pressed) return MACRO_NONE;
+    switch (id) {
+        case 0:
+            return MACRO( I(10), T(H), T(E), T(L), T(L), T(O), W(100), T(SPC), END );
+    }
+    return MACRO_NONE;
+}
+
+
+#ifndef KEYMAP_PACKED_ENABLE
+/* translates key to keycode */
+uint8_t keymap_key_to_keycode(uint8_t layer, keypos_t key)
+{
+    return pgm_read_byte(&keymaps[(layer)][(key.row)][(key.col)]);
+}
+#endif
+
+/* translates Fn keycode to action */
+action_t keymap_fn_to_action(uint8_t keycode)
+{
+    return (action_t){ .code = pgm_read_word(&fn_actions[FN_INDEX(keycode)]) };
+}
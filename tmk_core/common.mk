@@ -10,6 +10,7 @@ SRC +=	$(COMMON_DIR)/host.c \
 	$(COMMON_DIR)/print.c \
 	$(COMMON_DIR)/debug.c \
 	$(COMMON_DIR)/util.c \
+	$(COMMON_DIR)/debounce.c \
 	$(COMMON_DIR)/avr/suspend.c \
 	$(COMMON_DIR)/avr/xprintf.S \
 	$(COMMON_DIR)/avr/timer.c \
@@ -64,6 +65,29 @@ ifdef BACKLIGHT_ENABLE
     OPT_DEFS += -DBACKLIGHT_ENABLE
 endif
 
+# backlight_set() on Timer1 PWM with fades, instead of keyboard's own
+ifdef BACKLIGHT_PWM_ENABLE
+    ifdef SLEEP_LED_ENABLE
+        $(error BACKLIGHT_PWM_ENABLE and SLEEP_LED_ENABLE both use Timer1)
+    endif
+    SRC += $(COMMON_DIR)/avr/backlight_pwm.c
+    OPT_DEFS += -DBACKLIGHT_PWM_ENABLE
+endif
+
+ifdef LAYER_CACHE_ENABLE
+    OPT_DEFS += -DLAYER_CACHE_ENABLE
+endif
+
+ifdef LATENCY_ENABLE
+    SRC += $(COMMON_DIR)/latency.c
+    OPT_DEFS += -DLATENCY_ENABLE
+endif
+
+ifdef EVENT_TRACE_ENABLE
+    SRC += $(COMMON_DIR)/event_trace.c
+    OPT_DEFS += -DEVENT_TRACE_ENABLE
+endif
+
 ifdef KEYMAP_SECTION_ENABLE
     OPT_DEFS += -DKEYMAP_SECTION_ENABLE
 
@@ -76,6 +100,17 @@ ifdef KEYMAP_SECTION_ENABLE
     endif
 endif
 
+# keymaps[] stored sparse, generated by tool/keymap_pack
+ifdef KEYMAP_PACKED_ENABLE
+    ifdef KEYMAP_SECTION_ENABLE
+        $(error KEYMAP_PACKED_ENABLE and KEYMAP_SECTION_ENABLE can't be used together)
+    endif
+    include $(TMK_DIR)/tool/keymap_pack/keymap_pack.mk
+    SRC += $(COMMON_DIR)/keymap_packed.c
+    SRC += $(KEYMAP_PACKED_DATA)
+    OPT_DEFS += -DKEYMAP_PACKED_ENABLE
+endif
+
 # Version string
 OPT_DEFS += -DVERSION=$(shell (git describe --always --dirty || echo 'unknown') 2> /dev/null)
 
@@ -24,8 +24,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "action_layer.h"
 #include "action_tapping.h"
 #include "action_macro.h"
+#include "event_trace.h"
 #include "action_util.h"
 #include "action.h"
+#include "latency.h"
 
 #ifdef DEBUG_ACTION
 #include "debug.h"
@@ -36,6 +38,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 void action_exec(keyevent_t event)
 {
+    event_trace_key(event);
+
     if (!IS_NOEVENT(event)) {
         dprint("\n---- action_exec: start -----\n");
         dprint("EVENT: "); debug_event(event); dprintln();
@@ -53,6 +57,29 @@ void action_exec(keyevent_t event)
 #endif
 }
 
+/*
+ * TICK is needed only to settle a pending tap key when its TAPPING_TERM
+ * expires. Before that deadline and without tap key it changes nothing.
+ */
+bool action_tick_due(uint16_t time)
+{
+#ifndef NO_ACTION_TAPPING
+    return action_tapping_due(time);
+#else
+    return false;
+#endif
+}
+
+bool action_pending(void)
+{
+    if (action_macro_playing()) return true;
+#ifndef NO_ACTION_TAPPING
+    return action_tapping_pending();
+#else
+    return false;
+#endif
+}
+
 void process_action(keyrecord_t *record)
 {
     keyevent_t event = record->event;
@@ -61,6 +88,7 @@ void process_action(keyrecord_t *record)
 #endif
 
     if (IS_NOEVENT(event)) { return; }
+    latency_action();
 
     action_t action = layer_switch_get_action(event.key);
     dprint("ACTION: "); debug_action(action);
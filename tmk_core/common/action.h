@@ -49,6 +49,12 @@ typedef struct {
 /* Execute action per keyevent */
 void action_exec(keyevent_t event);
 
+/* Whether TICK event at the time has work to do */
+bool action_tick_due(uint16_t time);
+
+/* Whether any key event is not settled yet */
+bool action_pending(void);
+
 /* action for key */
 action_t action_for_key(uint8_t layer, keypos_t key);
 
@@ -3,6 +3,9 @@
 #include "action.h"
 #include "util.h"
 #include "action_layer.h"
+#ifdef LAYER_CACHE_ENABLE
+#include "matrix.h"
+#endif
 
 #ifdef DEBUG_ACTION
 #include "debug.h"
@@ -11,6 +14,26 @@
 #endif
 
 
+#ifdef LAYER_CACHE_ENABLE
+/*
+ * Resolved action cache
+ *
+ * Action of each key position resolved through current layer state. All
+ * entries are invalidated when layer state changes and each one is resolved
+ * again on its first lookup, so hot path is a single table load.
+ */
+static action_t layer_cache[MATRIX_ROWS][MATRIX_COLS];
+static matrix_row_t layer_cache_valid[MATRIX_ROWS];
+
+void layer_cache_clear(void)
+{
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        layer_cache_valid[r] = 0;
+    }
+}
+#endif
+
+
 /* 
  * Default Layer State
  */
@@ -22,6 +45,7 @@ static void default_layer_state_set(uint32_t state)
     default_layer_debug(); debug(" to ");
     default_layer_state = state;
     default_layer_debug(); debug("\n");
+    layer_cache_clear();
     clear_keyboard_but_mods(); // To avoid stuck keys
 }
 
@@ -63,6 +87,7 @@ static void layer_state_set(uint32_t state)
     layer_debug(); dprint(" to ");
     layer_state = state;
     layer_debug(); dprintln();
+    layer_cache_clear();
     clear_keyboard_but_mods(); // To avoid stuck keys
 }
 
@@ -112,7 +137,7 @@ void layer_debug(void)
 
 
 
-action_t layer_switch_get_action(keypos_t key)
+static action_t layer_resolve_action(keypos_t key)
 {
     action_t action;
     action.code = ACTION_TRANSPARENT;
@@ -136,3 +161,24 @@ action_t layer_switch_get_action(keypos_t key)
     return action;
 #endif
 }
+
+#ifdef LAYER_CACHE_ENABLE
+action_t layer_switch_get_action(keypos_t key)
+{
+    if (key.row >= MATRIX_ROWS || key.col >= MATRIX_COLS) {
+        return layer_resolve_action(key);
+    }
+
+    matrix_row_t col_bit = ((matrix_row_t)1<<key.col);
+    if (!(layer_cache_valid[key.row] & col_bit)) {
+        layer_cache[key.row][key.col] = layer_resolve_action(key);
+        layer_cache_valid[key.row] |= col_bit;
+    }
+    return layer_cache[key.row][key.col];
+}
+#else
+action_t layer_switch_get_action(keypos_t key)
+{
+    return layer_resolve_action(key);
+}
+#endif
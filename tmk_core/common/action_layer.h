@@ -74,4 +74,11 @@ void layer_xor(uint32_t state);
 /* return action depending on current layer status */
 action_t layer_switch_get_action(keypos_t key);
 
+/* invalidate resolved actions, call when keymap is changed at runtime */
+#ifdef LAYER_CACHE_ENABLE
+void layer_cache_clear(void);
+#else
+#define layer_cache_clear()
+#endif
+
 #endif
@@ -14,10 +14,12 @@ GNU General Public License for more details.
 You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
+#include <stddef.h>
 #include "action.h"
 #include "action_util.h"
 #include "action_macro.h"
-#include "wait.h"
+#include "host.h"
+#include "timer.h"
 
 #ifdef DEBUG_ACTION
 #include "debug.h"
@@ -28,14 +30,68 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #ifndef NO_ACTION_MACRO
 
-#define MACRO_READ()  (macro = MACRO_GET(macro_p++))
+/*
+ * Macro player
+ *
+ * Macros are queued and played a command at a time from keyboard_task(), so
+ * that matrix scan and USB keep running during WAIT and INTERVAL. A command
+ * which changes report is executed only when host driver can take the report,
+ * reports of a macro are not superseded in driver queue.
+ */
+#ifndef MACRO_QUEUE_SIZE
+#define MACRO_QUEUE_SIZE    4
+#endif
+
+static const macro_t *queue[MACRO_QUEUE_SIZE];
+static uint8_t queue_head = 0;
+static uint8_t queue_count = 0;
+
+/* macro being played */
+static const macro_t *playing = NULL;
+static uint8_t interval = 0;
+static uint16_t delay_start = 0;
+static uint16_t delay = 0;
+
 void action_macro_play(const macro_t *macro_p)
+{
+    if (!macro_p) return;
+    if (queue_count == MACRO_QUEUE_SIZE) {
+        dprint("macro: queue full\n");
+        return;
+    }
+    queue[(queue_head + queue_count) % MACRO_QUEUE_SIZE] = macro_p;
+    queue_count++;
+
+    // start without waiting next keyboard_task()
+    action_macro_task();
+}
+
+bool action_macro_playing(void)
+{
+    return playing || queue_count;
+}
+
+#define MACRO_READ()  (macro = MACRO_GET(playing++))
+void action_macro_task(void)
 {
     macro_t macro = END;
-    uint8_t interval = 0;
 
-    if (!macro_p) return;
     while (true) {
+        if (!playing) {
+            if (!queue_count) return;
+            playing = queue[queue_head];
+            queue_head = (queue_head + 1) % MACRO_QUEUE_SIZE;
+            queue_count--;
+            interval = 0;
+            delay = 0;
+        }
+
+        if (delay) {
+            if (timer_elapsed(delay_start) < delay) return;
+            delay = 0;
+        }
+        if (!host_keyboard_ready()) return;
+
         switch (MACRO_READ()) {
             case KEY_DOWN:
                 MACRO_READ();
@@ -58,7 +114,7 @@ void action_macro_play(const macro_t *macro_p)
             case WAIT:
                 MACRO_READ();
                 dprintf("WAIT(%u)\n", macro);
-                { uint8_t ms = macro; while (ms--) wait_ms(1); }
+                delay = macro;
                 break;
             case INTERVAL:
                 interval = MACRO_READ();
@@ -74,10 +130,12 @@ void action_macro_play(const macro_t *macro_p)
                 break;
             case END:
             default:
-                return;
+                playing = NULL;
+                continue;
         }
         // interval
-        { uint8_t ms = interval; while (ms--) wait_ms(1); }
+        delay += interval;
+        delay_start = timer_read();
     }
 }
 #endif
@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef ACTION_MACRO_H
 #define ACTION_MACRO_H
 #include <stdint.h>
+#include <stdbool.h>
 #include "progmem.h"
 
 
@@ -28,9 +29,14 @@ typedef uint8_t macro_t;
 
 
 #ifndef NO_ACTION_MACRO
+/* queue macro, played by action_macro_task() */
 void action_macro_play(const macro_t *macro_p);
+void action_macro_task(void);
+bool action_macro_playing(void);
 #else
 #define action_macro_play(macro)
+#define action_macro_task()
+#define action_macro_playing()  false
 #endif
 
 
@@ -70,6 +70,25 @@ void action_tapping_process(keyrecord_t record)
 }
 
 
+/* Deadline of tapping
+ *
+ * Tap key pressed without tap count is settled as hold and released tap key
+ * is forgotten when TAPPING_TERM expires. Other states don't change with time.
+ */
+bool action_tapping_due(uint16_t time)
+{
+    if (!IS_TAPPING()) return false;
+    if (tapping_key.event.pressed && tapping_key.tap.count > 0) return false;
+    return TIMER_DIFF_16(time, tapping_key.event.time) >= TAPPING_TERM;
+}
+
+/* tap key or events waiting for it are not settled yet */
+bool action_tapping_pending(void)
+{
+    return IS_TAPPING() || waiting_buffer_head != waiting_buffer_tail;
+}
+
+
 /* Tapping
  *
  * Rule: Tap key is typed(pressed and released) within TAPPING_TERM.
@@ -34,6 +34,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #ifndef NO_ACTION_TAPPING
 void action_tapping_process(keyrecord_t record);
+bool action_tapping_due(uint16_t time);
+bool action_tapping_pending(void);
 #endif
 
 #endif
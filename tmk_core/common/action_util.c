@@ -22,17 +22,30 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 static inline void add_key_byte(uint8_t code);
 static inline void del_key_byte(uint8_t code);
-#ifdef NKRO_ENABLE
-static inline void add_key_bit(uint8_t code);
-static inline void del_key_bit(uint8_t code);
-#endif
+static void build_keyboard_report(void);
 
 static uint8_t real_mods = 0;
 static uint8_t weak_mods = 0;
 
+/*
+ * Pressed keys
+ *
+ * Bitmap of all 256 keycodes with count of pressed keys is the canonical
+ * state, add/del/has_anykey don't search. Report is built from it on send:
+ * NKRO bits are copied from the bitmap and boot report takes keys from
+ * boot_keys[], which remembers order of press to select 6 keys.
+ */
+#define BOOT_KEYS   6
+
+static uint8_t key_bits[256/8];
+static uint8_t key_count = 0;
+static uint8_t boot_keys[BOOT_KEYS];
+
+#define KEY_BIT_IS_ON(code)     (key_bits[(code)>>3] & (1<<((code)&7)))
+
 #ifdef USB_6KRO_ENABLE
-#define RO_ADD(a, b) ((a + b) % KEYBOARD_REPORT_KEYS)
-#define RO_SUB(a, b) ((a - b + KEYBOARD_REPORT_KEYS) % KEYBOARD_REPORT_KEYS)
+#define RO_ADD(a, b) ((a + b) % BOOT_KEYS)
+#define RO_SUB(a, b) ((a - b + BOOT_KEYS) % BOOT_KEYS)
 #define RO_INC(a) RO_ADD(a, 1)
 #define RO_DEC(a) RO_SUB(a, 1)
 static int8_t cb_head = 0;
@@ -69,35 +82,58 @@ void send_keyboard_report(void) {
         }
     }
 #endif
+    build_keyboard_report();
     host_keyboard_send(keyboard_report);
 }
 
+#ifdef NKRO_ENABLE
+/*
+ * Boot and NKRO reports go to different interfaces and host keeps state of
+ * each. Pressed keys are released on the old one and then sent on the new
+ * one, without key events processed in between. clear_keyboard() would drop
+ * keys still held and leave them stuck on the old interface.
+ */
+void set_keyboard_nkro(bool nkro)
+{
+    if (keyboard_nkro == nkro) return;
+
+    report_keyboard_t released = {};
+    host_keyboard_send(&released);
+    keyboard_nkro = nkro;
+    send_keyboard_report();
+}
+#endif
+
 /* key */
 void add_key(uint8_t key)
 {
-#ifdef NKRO_ENABLE
-    if (keyboard_nkro) {
-        add_key_bit(key);
-        return;
-    }
-#endif
+    if (!key || KEY_BIT_IS_ON(key)) return;
+    key_bits[key>>3] |= 1<<(key&7);
+    key_count++;
     add_key_byte(key);
 }
 
 void del_key(uint8_t key)
 {
-#ifdef NKRO_ENABLE
-    if (keyboard_nkro) {
-        del_key_bit(key);
-        return;
-    }
-#endif
+    if (!KEY_BIT_IS_ON(key)) return;
+    key_bits[key>>3] &= ~(1<<(key&7));
+    key_count--;
     del_key_byte(key);
 }
 
 void clear_keys(void)
 {
     // not clear mods
+    for (uint8_t i = 0; i < sizeof(key_bits); i++) {
+        key_bits[i] = 0;
+    }
+    key_count = 0;
+    for (uint8_t i = 0; i < BOOT_KEYS; i++) {
+        boot_keys[i] = 0;
+    }
+#ifdef USB_6KRO_ENABLE
+    cb_head = cb_tail = cb_count = 0;
+#endif
     for (int8_t i = 1; i < KEYBOARD_REPORT_SIZE; i++) {
         keyboard_report->raw[i] = 0;
     }
@@ -144,12 +180,7 @@ void clear_oneshot_mods(void)
  */
 uint8_t has_anykey(void)
 {
-    uint8_t cnt = 0;
-    for (uint8_t i = 1; i < KEYBOARD_REPORT_SIZE; i++) {
-        if (keyboard_report->raw[i])
-            cnt++;
-    }
-    return cnt;
+    return key_count;
 }
 
 uint8_t has_anymod(void)
@@ -161,23 +192,24 @@ uint8_t get_first_key(void)
 {
 #ifdef NKRO_ENABLE
     if (keyboard_nkro) {
+        if (!key_count) return 0;
         uint8_t i = 0;
-        for (; i < KEYBOARD_REPORT_BITS && !keyboard_report->nkro.bits[i]; i++)
+        for (; !key_bits[i]; i++)
             ;
-        return i<<3 | biton(keyboard_report->nkro.bits[i]);
+        return i<<3 | biton(key_bits[i]);
     }
 #endif
 #ifdef USB_6KRO_ENABLE
     uint8_t i = cb_head;
     do {
-        if (keyboard_report->keys[i] != 0) {
+        if (boot_keys[i] != 0) {
             break;
         }
         i = RO_INC(i);
     } while (i != cb_tail);
-    return keyboard_report->keys[i];
+    return boot_keys[i];
 #else
-    return keyboard_report->keys[0];
+    return boot_keys[0];
 #endif
 }
 
@@ -191,10 +223,10 @@ static inline void add_key_byte(uint8_t code)
     int8_t empty = -1;
     if (cb_count) {
         do {
-            if (keyboard_report->keys[i] == code) {
+            if (boot_keys[i] == code) {
                 return;
             }
-            if (empty == -1 && keyboard_report->keys[i] == 0) {
+            if (empty == -1 && boot_keys[i] == 0) {
                 empty = i;
             }
             i = RO_INC(i);
@@ -212,9 +244,9 @@ static inline void add_key_byte(uint8_t code)
                     uint8_t offset = 1;
                     i = RO_INC(empty);
                     do {
-                        if (keyboard_report->keys[i] != 0) {
-                            keyboard_report->keys[empty] = keyboard_report->keys[i];
-                            keyboard_report->keys[i] = 0;
+                        if (boot_keys[i] != 0) {
+                            boot_keys[empty] = boot_keys[i];
+                            boot_keys[i] = 0;
                             empty = RO_INC(empty);
                         }
                         else {
@@ -228,23 +260,23 @@ static inline void add_key_byte(uint8_t code)
         }
     }
     // add to tail
-    keyboard_report->keys[cb_tail] = code;
+    boot_keys[cb_tail] = code;
     cb_tail = RO_INC(cb_tail);
     cb_count++;
 #else
     int8_t i = 0;
     int8_t empty = -1;
-    for (; i < KEYBOARD_REPORT_KEYS; i++) {
-        if (keyboard_report->keys[i] == code) {
+    for (; i < BOOT_KEYS; i++) {
+        if (boot_keys[i] == code) {
             break;
         }
-        if (empty == -1 && keyboard_report->keys[i] == 0) {
+        if (empty == -1 && boot_keys[i] == 0) {
             empty = i;
         }
     }
-    if (i == KEYBOARD_REPORT_KEYS) {
+    if (i == BOOT_KEYS) {
         if (empty != -1) {
-            keyboard_report->keys[empty] = code;
+            boot_keys[empty] = code;
         }
     }
 #endif
@@ -256,8 +288,8 @@ static inline void del_key_byte(uint8_t code)
     uint8_t i = cb_head;
     if (cb_count) {
         do {
-            if (keyboard_report->keys[i] == code) {
-                keyboard_report->keys[i] = 0;
+            if (boot_keys[i] == code) {
+                boot_keys[i] = 0;
                 cb_count--;
                 if (cb_count == 0) {
                     // reset head and tail
@@ -267,7 +299,7 @@ static inline void del_key_byte(uint8_t code)
                     // left shift when next to tail
                     do {
                         cb_tail = RO_DEC(cb_tail);
-                        if (keyboard_report->keys[RO_DEC(cb_tail)] != 0) {
+                        if (boot_keys[RO_DEC(cb_tail)] != 0) {
                             break;
                         }
                     } while (cb_tail != cb_head);
@@ -278,30 +310,26 @@ static inline void del_key_byte(uint8_t code)
         } while (i != cb_tail);
     }
 #else
-    for (uint8_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
-        if (keyboard_report->keys[i] == code) {
-            keyboard_report->keys[i] = 0;
+    for (uint8_t i = 0; i < BOOT_KEYS; i++) {
+        if (boot_keys[i] == code) {
+            boot_keys[i] = 0;
         }
     }
 #endif
 }
 
-#ifdef NKRO_ENABLE
-static inline void add_key_bit(uint8_t code)
+static void build_keyboard_report(void)
 {
-    if ((code>>3) < KEYBOARD_REPORT_BITS) {
-        keyboard_report->nkro.bits[code>>3] |= 1<<(code&7);
-    } else {
-        dprintf("add_key_bit: can't add: %02X\n", code);
+#ifdef NKRO_ENABLE
+    if (keyboard_nkro) {
+        for (uint8_t i = 0; i < KEYBOARD_REPORT_BITS; i++) {
+            keyboard_report->nkro.bits[i] = key_bits[i];
+        }
+        return;
     }
-}
-
-static inline void del_key_bit(uint8_t code)
-{
-    if ((code>>3) < KEYBOARD_REPORT_BITS) {
-        keyboard_report->nkro.bits[code>>3] &= ~(1<<(code&7));
-    } else {
-        dprintf("del_key_bit: can't del: %02X\n", code);
+#endif
+    keyboard_report->reserved = 0;
+    for (uint8_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
+        keyboard_report->keys[i] = (i < BOOT_KEYS ? boot_keys[i] : 0);
     }
 }
-#endif
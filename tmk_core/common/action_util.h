@@ -18,6 +18,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define ACTION_UTIL_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "report.h"
 
 #ifdef __cplusplus
@@ -33,6 +34,11 @@ void add_key(uint8_t key);
 void del_key(uint8_t key);
 void clear_keys(void);
 
+#ifdef NKRO_ENABLE
+/* switch report format keeping keys pressed on host */
+void set_keyboard_nkro(bool nkro);
+#endif
+
 /* modifier */
 uint8_t get_mods(void);
 void add_mods(uint8_t mods);
@@ -0,0 +1,221 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include "backlight.h"
+#include "backlight_pwm.h"
+
+/*
+ * Backlight on Timer1 hardware PWM
+ *
+ * Timer1 runs 8-bit fast PWM at clk/8(7.8kHz at 16MHz) and drives one output
+ * compare pin, so static brightness costs no CPU. Brightness is a step(0-63)
+ * of curve table in PROGMEM. Fades and breathing advance a step in overflow
+ * interrupt, which is enabled only while brightness is changing.
+ *
+ * Timer1 is shared with sleep_led.c, they can't be used together.
+ */
+#ifdef SLEEP_LED_ENABLE
+#   error "BACKLIGHT_PWM_ENABLE and SLEEP_LED_ENABLE both use Timer1"
+#endif
+
+/* Output compare pin */
+#define BACKLIGHT_PWM_OC1A  1
+#define BACKLIGHT_PWM_OC1B  2
+#define BACKLIGHT_PWM_OC1C  3
+
+#ifndef BACKLIGHT_PWM_CHANNEL
+#   define BACKLIGHT_PWM_CHANNEL    BACKLIGHT_PWM_OC1B
+#endif
+
+#if defined(__AVR_ATmega32U4__) || defined(__AVR_AT90USB646__) || defined(__AVR_AT90USB1286__)
+#   if BACKLIGHT_PWM_CHANNEL == BACKLIGHT_PWM_OC1A
+#       define BL_OCR   OCR1A
+#       define BL_COM1  _BV(COM1A1)
+#       define BL_COM0  _BV(COM1A0)
+#       define BL_PIN   PB5
+#   elif BACKLIGHT_PWM_CHANNEL == BACKLIGHT_PWM_OC1B
+#       define BL_OCR   OCR1B
+#       define BL_COM1  _BV(COM1B1)
+#       define BL_COM0  _BV(COM1B0)
+#       define BL_PIN   PB6
+#   elif BACKLIGHT_PWM_CHANNEL == BACKLIGHT_PWM_OC1C
+#       define BL_OCR   OCR1C
+#       define BL_COM1  _BV(COM1C1)
+#       define BL_COM0  _BV(COM1C0)
+#       define BL_PIN   PB7
+#   endif
+#elif defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__) || defined(__AVR_ATmega88__)
+#   if BACKLIGHT_PWM_CHANNEL == BACKLIGHT_PWM_OC1A
+#       define BL_OCR   OCR1A
+#       define BL_COM1  _BV(COM1A1)
+#       define BL_COM0  _BV(COM1A0)
+#       define BL_PIN   PB1
+#   elif BACKLIGHT_PWM_CHANNEL == BACKLIGHT_PWM_OC1B
+#       define BL_OCR   OCR1B
+#       define BL_COM1  _BV(COM1B1)
+#       define BL_COM0  _BV(COM1B0)
+#       define BL_PIN   PB2
+#   endif
+#endif
+#ifndef BL_OCR
+#   error "BACKLIGHT_PWM_CHANNEL: not supported on this MCU"
+#endif
+
+/* LED is lit when pin is low */
+#ifdef BACKLIGHT_PWM_ACTIVE_LOW
+#   define BL_COM_ON    (BL_COM1 | BL_COM0)         /* inverting */
+#   define BL_PIN_OFF() (PORTB |= _BV(BL_PIN))
+#else
+#   define BL_COM_ON    BL_COM1                     /* non-inverting */
+#   define BL_PIN_OFF() (PORTB &= ~_BV(BL_PIN))
+#endif
+
+#ifndef BACKLIGHT_LEVELS
+#   define BACKLIGHT_LEVELS 3
+#endif
+/* time of fade over full range and of a breath cycle */
+#ifndef BACKLIGHT_PWM_FADE_MS
+#   define BACKLIGHT_PWM_FADE_MS    500
+#endif
+#ifndef BACKLIGHT_PWM_BREATH_MS
+#   define BACKLIGHT_PWM_BREATH_MS  4000
+#endif
+
+/* overflow interrupts per step */
+#define PWM_HZ          (F_CPU / 8 / 256)
+#define TICKS(ms, steps) \
+    ((uint32_t)PWM_HZ * (ms) / 1000 / (steps) ? (uint32_t)PWM_HZ * (ms) / 1000 / (steps) : 1)
+#define FADE_TICKS      TICKS(BACKLIGHT_PWM_FADE_MS, BACKLIGHT_PWM_STEPS - 1)
+#define BREATH_TICKS    TICKS(BACKLIGHT_PWM_BREATH_MS, 2 * (BACKLIGHT_PWM_STEPS - 1))
+
+
+/* Duty of brightness step
+ * Gamma 2.2 by default, so that each step looks like same change.
+ * (0..63).each {|x| p [(255*(x/63.0)**2.2).round, x > 0 ? 1 : 0].max }
+ * BACKLIGHT_PWM_CURVE_LINEAR uses duty proportional to step.
+ */
+static const uint8_t curve[BACKLIGHT_PWM_STEPS] PROGMEM = {
+#ifdef BACKLIGHT_PWM_CURVE_LINEAR
+0, 4, 8, 12, 16, 20, 24, 28, 32, 36, 40, 45, 49, 53, 57, 61,
+65, 69, 73, 77, 81, 85, 89, 93, 97, 101, 105, 109, 113, 117, 121, 125,
+130, 134, 138, 142, 146, 150, 154, 158, 162, 166, 170, 174, 178, 182, 186, 190,
+194, 198, 202, 206, 210, 215, 219, 223, 227, 231, 235, 239, 243, 247, 251, 255
+#else
+0, 1, 1, 1, 1, 1, 1, 2, 3, 4, 4, 5, 7, 8, 9, 11,
+13, 14, 16, 18, 20, 23, 25, 28, 31, 33, 36, 40, 43, 46, 50, 54,
+57, 61, 66, 70, 74, 79, 84, 89, 94, 99, 105, 110, 116, 122, 128, 134,
+140, 147, 153, 160, 167, 174, 182, 189, 197, 205, 213, 221, 229, 238, 246, 255
+#endif
+};
+
+/* written by main with interrupt disabled */
+static volatile uint8_t target = 0;
+static volatile bool breathing = false;
+static volatile uint16_t step_ticks = FADE_TICKS;
+
+/* interrupt only */
+static uint8_t current = 0;
+static bool breath_up = true;
+static uint16_t tick = 0;
+
+static bool initialized = false;
+
+
+/* disconnect pin at duty 0, fast PWM still outputs a clock of spike */
+static inline void pwm_write(uint8_t duty)
+{
+    if (duty) {
+        BL_OCR = duty;
+        TCCR1A |= BL_COM_ON;
+    } else {
+        TCCR1A &= ~(BL_COM1 | BL_COM0);
+    }
+}
+
+ISR(TIMER1_OVF_vect)
+{
+    if (++tick < step_ticks) return;
+    tick = 0;
+
+    /* breathe up to brightness of level, stay off when level is 0 */
+    if (breathing && target) {
+        if (breath_up) {
+            if (current < target) current++;
+            if (current >= target) breath_up = false;
+        } else {
+            if (current) current--;
+            if (!current) breath_up = true;
+        }
+    } else if (current < target) {
+        current++;
+    } else if (current > target) {
+        current--;
+    } else {
+        TIMSK1 &= ~_BV(TOIE1);
+        return;
+    }
+    pwm_write(pgm_read_byte(&curve[current]));
+}
+
+
+void backlight_pwm_init(void)
+{
+    BL_PIN_OFF();
+    DDRB |= _BV(BL_PIN);
+
+    uint8_t sreg = SREG;
+    cli();
+    /* Fast PWM 8-bit, clk/8 */
+    TCCR1A = _BV(WGM10);
+    TCCR1B = _BV(WGM12) | _BV(CS11);
+    current = 0;
+    pwm_write(0);
+    SREG = sreg;
+    initialized = true;
+}
+
+void backlight_pwm_fade(uint8_t step)
+{
+    if (!initialized) backlight_pwm_init();
+    if (step >= BACKLIGHT_PWM_STEPS) step = BACKLIGHT_PWM_STEPS - 1;
+
+    uint8_t sreg = SREG;
+    cli();
+    target = step;
+    if (!breathing) step_ticks = FADE_TICKS;
+    TIMSK1 |= _BV(TOIE1);
+    SREG = sreg;
+}
+
+void backlight_pwm_breathing(bool on)
+{
+    if (!initialized) backlight_pwm_init();
+
+    uint8_t sreg = SREG;
+    cli();
+    breathing = on;
+    breath_up = true;
+    step_ticks = on ? BREATH_TICKS : FADE_TICKS;
+    /* fades back to target when stopped */
+    TIMSK1 |= _BV(TOIE1);
+    SREG = sreg;
+}
+
+void backlight_pwm_breathing_toggle(void)
+{
+    backlight_pwm_breathing(!breathing);
+}
+
+bool backlight_pwm_is_breathing(void)
+{
+    return breathing;
+}
+
+/* level of backlight.c: 0(off) to BACKLIGHT_LEVELS */
+void backlight_set(uint8_t level)
+{
+    if (level > BACKLIGHT_LEVELS) level = BACKLIGHT_LEVELS;
+    backlight_pwm_fade((uint16_t)level * (BACKLIGHT_PWM_STEPS - 1) / BACKLIGHT_LEVELS);
+}
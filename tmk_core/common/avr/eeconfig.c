@@ -1,45 +1,213 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <avr/eeprom.h>
+#include "timer.h"
 #include "eeconfig.h"
 
-void eeconfig_init(void)
+/*
+ * Parameters are kept in RAM. Write functions only change the RAM copy and
+ * eeconfig_task() commits it when it has not changed for EECONFIG_COMMIT_DELAY,
+ * so that stepping backlight level or toggling an option repeatedly costs
+ * one commit.
+ *
+ * Commit writes a whole record to the next slot of a ring in eeprom and load
+ * picks valid record with the newest sequence number. Writes are spread over
+ * EECONFIG_SLOTS slots and power loss during commit leaves previous record.
+ * Record is written a byte per eeconfig_task() call when eeprom is ready, so
+ * that keyboard_task() never waits for eeprom write(3.4ms per byte).
+ */
+typedef struct {
+    uint8_t seq;
+    uint8_t debug;
+    uint8_t default_layer;
+    uint8_t keymap;
+    uint8_t mousekey_accel;
+    uint8_t backlight;
+    uint8_t reserved;
+    uint8_t check;
+} eeconfig_record_t;
+
+static eeconfig_record_t config;        /* RAM copy */
+static eeconfig_record_t committed;     /* newest record in eeprom */
+static uint8_t committed_slot = EECONFIG_SLOTS - 1;
+static bool loaded = false;
+static bool dirty = false;
+static uint16_t dirty_time = 0;
+
+/* commit in progress, write_pos is sizeof(record) when idle */
+static eeconfig_record_t writing;
+static uint8_t write_pos = sizeof(eeconfig_record_t);
+
+
+static uint8_t *slot_addr(uint8_t slot)
+{
+    return EECONFIG_SLOT_BASE + slot * sizeof(eeconfig_record_t);
+}
+
+/* erased(0xFF) and cleared(0x00) slots never pass */
+static uint8_t record_check(eeconfig_record_t *r)
+{
+    uint8_t sum = 0;
+    uint8_t *p = (uint8_t *)r;
+    for (uint8_t i = 0; i < sizeof(eeconfig_record_t) - 1; i++) {
+        sum += p[i];
+    }
+    return ~sum;
+}
+
+static bool record_changed(void)
 {
-    eeprom_write_word(EECONFIG_MAGIC,          EECONFIG_MAGIC_NUMBER);
-    eeprom_write_byte(EECONFIG_DEBUG,          0);
-    eeprom_write_byte(EECONFIG_DEFAULT_LAYER,  0);
-    eeprom_write_byte(EECONFIG_KEYMAP,         0);
-    eeprom_write_byte(EECONFIG_MOUSEKEY_ACCEL, 0);
+    return config.debug          != committed.debug          ||
+           config.default_layer  != committed.default_layer  ||
+           config.keymap         != committed.keymap         ||
+           config.mousekey_accel != committed.mousekey_accel ||
+           config.backlight      != committed.backlight;
+}
+
+static void commit_start(void)
+{
+    writing = config;
+    writing.seq = committed.seq + 1;
+    writing.reserved = 0;
+    writing.check = record_check(&writing);
+    write_pos = 0;
+}
+
+/* update_byte skips bytes which the slot already holds from previous round */
+static void commit_step(void)
+{
+    uint8_t slot = (committed_slot + 1) % EECONFIG_SLOTS;
+    eeprom_update_byte(slot_addr(slot) + write_pos, ((uint8_t *)&writing)[write_pos]);
+    if (++write_pos == sizeof(eeconfig_record_t)) {
+        committed = writing;
+        committed_slot = slot;
+    }
+}
+
+static void commit_finish(void)
+{
+    while (write_pos < sizeof(eeconfig_record_t)) {
+        commit_step();
+    }
+}
+
+static inline void load_once(void)
+{
+    if (!loaded) eeconfig_load();
+}
+
+static void config_set(uint8_t *field, uint8_t val)
+{
+    load_once();
+    if (*field == val) return;
+    *field = val;
+    dirty = true;
+    dirty_time = timer_read();
+}
+
+
+void eeconfig_load(void)
+{
+    bool found = false;
+    for (uint8_t i = 0; i < EECONFIG_SLOTS; i++) {
+        eeconfig_record_t r;
+        eeprom_read_block(&r, slot_addr(i), sizeof(r));
+        if (r.check != record_check(&r)) continue;
+        // sequence number wraps around
+        if (found && (int8_t)(r.seq - committed.seq) <= 0) continue;
+        committed = r;
+        committed_slot = i;
+        found = true;
+    }
+    if (!found) {
+        committed = (eeconfig_record_t){};
+        committed_slot = EECONFIG_SLOTS - 1;
+    }
+    config = committed;
+    loaded = true;
+    dirty = false;
+    write_pos = sizeof(eeconfig_record_t);
+
+    if (eeprom_read_word(EECONFIG_MAGIC) == EECONFIG_MAGIC_NUMBER_V0) {
+        config.debug          = eeprom_read_byte(EECONFIG_DEBUG);
+        config.default_layer  = eeprom_read_byte(EECONFIG_DEFAULT_LAYER);
+        config.keymap         = eeprom_read_byte(EECONFIG_KEYMAP);
+        config.mousekey_accel = eeprom_read_byte(EECONFIG_MOUSEKEY_ACCEL);
 #ifdef BACKLIGHT_ENABLE
-    eeprom_write_byte(EECONFIG_BACKLIGHT,      0);
+        config.backlight      = eeprom_read_byte(EECONFIG_BACKLIGHT);
 #endif
+        commit_start();
+        commit_finish();
+        eeprom_update_word(EECONFIG_MAGIC, EECONFIG_MAGIC_NUMBER);
+    }
+}
+
+void eeconfig_task(void)
+{
+    if (write_pos < sizeof(eeconfig_record_t)) {
+        if (eeprom_is_ready()) commit_step();
+        return;
+    }
+    if (dirty && timer_elapsed(dirty_time) >= EECONFIG_COMMIT_DELAY) {
+        dirty = false;
+        if (record_changed()) commit_start();
+    }
+}
+
+void eeconfig_flush(void)
+{
+    if (!loaded) return;
+    commit_finish();
+    if (dirty) {
+        dirty = false;
+        if (record_changed()) {
+            commit_start();
+            commit_finish();
+        }
+    }
+}
+
+void eeconfig_init(void)
+{
+    load_once();
+    commit_finish();
+    config.debug          = 0;
+    config.default_layer  = 0;
+    config.keymap         = 0;
+    config.mousekey_accel = 0;
+    config.backlight      = 0;
+    dirty = false;
+    commit_start();
+    commit_finish();
+    eeprom_update_word(EECONFIG_MAGIC, EECONFIG_MAGIC_NUMBER);
 }
 
 void eeconfig_enable(void)
 {
-    eeprom_write_word(EECONFIG_MAGIC, EECONFIG_MAGIC_NUMBER);
+    eeprom_update_word(EECONFIG_MAGIC, EECONFIG_MAGIC_NUMBER);
 }
 
 void eeconfig_disable(void)
 {
-    eeprom_write_word(EECONFIG_MAGIC, 0xFFFF);
+    eeprom_update_word(EECONFIG_MAGIC, 0xFFFF);
 }
 
 bool eeconfig_is_enabled(void)
 {
+    load_once();
     return (eeprom_read_word(EECONFIG_MAGIC) == EECONFIG_MAGIC_NUMBER);
 }
 
-uint8_t eeconfig_read_debug(void)      { return eeprom_read_byte(EECONFIG_DEBUG); }
-void eeconfig_write_debug(uint8_t val) { eeprom_write_byte(EECONFIG_DEBUG, val); }
+uint8_t eeconfig_read_debug(void)      { load_once(); return config.debug; }
+void eeconfig_write_debug(uint8_t val) { config_set(&config.debug, val); }
 
-uint8_t eeconfig_read_default_layer(void)      { return eeprom_read_byte(EECONFIG_DEFAULT_LAYER); }
-void eeconfig_write_default_layer(uint8_t val) { eeprom_write_byte(EECONFIG_DEFAULT_LAYER, val); }
+uint8_t eeconfig_read_default_layer(void)      { load_once(); return config.default_layer; }
+void eeconfig_write_default_layer(uint8_t val) { config_set(&config.default_layer, val); }
 
-uint8_t eeconfig_read_keymap(void)      { return eeprom_read_byte(EECONFIG_KEYMAP); }
-void eeconfig_write_keymap(uint8_t val) { eeprom_write_byte(EECONFIG_KEYMAP, val); }
+uint8_t eeconfig_read_keymap(void)      { load_once(); return config.keymap; }
+void eeconfig_write_keymap(uint8_t val) { config_set(&config.keymap, val); }
 
 #ifdef BACKLIGHT_ENABLE
-uint8_t eeconfig_read_backlight(void)      { return eeprom_read_byte(EECONFIG_BACKLIGHT); }
-void eeconfig_write_backlight(uint8_t val) { eeprom_write_byte(EECONFIG_BACKLIGHT, val); }
+uint8_t eeconfig_read_backlight(void)      { load_once(); return config.backlight; }
+void eeconfig_write_backlight(uint8_t val) { config_set(&config.backlight, val); }
 #endif
@@ -5,9 +5,11 @@
 #include "matrix.h"
 #include "action.h"
 #include "backlight.h"
+#include "eeconfig.h"
 #include "suspend_avr.h"
 #include "suspend.h"
 #include "timer.h"
+#include "debug.h"
 #ifdef PROTOCOL_LUFA
 #include "lufa.h"
 #endif
@@ -54,12 +56,132 @@ void suspend_idle(uint8_t time)
  *          WDTO_8S
  */
 static uint8_t wdt_timeout = 0;
+static volatile bool wdt_woke = false;
+
+/* Pin change wakeup
+ * With SUSPEND_WAKEUP_PCMSK0(or PCMSK1, PCMSK2) in config.h, keyboard drives
+ * all rows active in matrix_wakeup_arm() so that any key changes its column
+ * pin, and MCU sleeps until pin change interrupt on the columns. Matrix is
+ * scanned only after the interrupt instead of every 15ms by watchdog.
+ * Watchdog still wakes every SUSPEND_WAKEUP_WDTO for main loop.
+ */
+#if defined(SUSPEND_WAKEUP_PCMSK0) || defined(SUSPEND_WAKEUP_PCMSK1) || defined(SUSPEND_WAKEUP_PCMSK2)
+#   define SUSPEND_WAKEUP_PCINT
+#   ifndef SUSPEND_WAKEUP_WDTO
+#       define SUSPEND_WAKEUP_WDTO  WDTO_1S
+#   endif
+static volatile bool pcint_woke = false;
+static volatile uint32_t pcint_time;
+#endif
+
+/* Suspend statistics printed on wakeup
+ * Average current is estimated from time awake and asleep. Length of sleep
+ * ended by pin change is unknown and estimated as half of watchdog timeout.
+ */
+#ifndef SUSPEND_ACTIVE_UA
+#   define SUSPEND_ACTIVE_UA    10000   // ATmega32U4 16MHz 5V
+#endif
+#ifndef SUSPEND_SLEEP_UA
+#   define SUSPEND_SLEEP_UA     10      // power-down with watchdog
+#endif
+static struct {
+    uint16_t sleeps;
+    uint16_t scans;
+    uint32_t awake_us;
+    uint32_t sleep_ms;
+    uint16_t wakes;             // by pin change with key down
+    uint32_t wake_latency_sum;  // us from pin change to key found
+    uint32_t wake_latency_max;
+} stats;
+static uint32_t awake_since = 0;    // 0: first sleep of suspend
+
+#ifdef SUSPEND_WAKEUP_PCINT
+static void pcint_enable(void)
+{
+#ifdef SUSPEND_WAKEUP_PCMSK0
+    PCMSK0 = SUSPEND_WAKEUP_PCMSK0;
+    PCIFR = _BV(PCIF0);
+    PCICR |= _BV(PCIE0);
+#endif
+#ifdef SUSPEND_WAKEUP_PCMSK1
+    PCMSK1 = SUSPEND_WAKEUP_PCMSK1;
+    PCIFR = _BV(PCIF1);
+    PCICR |= _BV(PCIE1);
+#endif
+#ifdef SUSPEND_WAKEUP_PCMSK2
+    PCMSK2 = SUSPEND_WAKEUP_PCMSK2;
+    PCIFR = _BV(PCIF2);
+    PCICR |= _BV(PCIE2);
+#endif
+}
+
+static void pcint_disable(void)
+{
+#ifdef SUSPEND_WAKEUP_PCMSK0
+    PCICR &= ~_BV(PCIE0);
+#endif
+#ifdef SUSPEND_WAKEUP_PCMSK1
+    PCICR &= ~_BV(PCIE1);
+#endif
+#ifdef SUSPEND_WAKEUP_PCMSK2
+    PCICR &= ~_BV(PCIE2);
+#endif
+}
+
+static void pcint_wakeup(void)
+{
+    if (!pcint_woke) {
+        pcint_woke = true;
+        pcint_time = timer_read_us();
+    }
+}
+#ifdef SUSPEND_WAKEUP_PCMSK0
+ISR(PCINT0_vect) { pcint_wakeup(); }
+#endif
+#ifdef SUSPEND_WAKEUP_PCMSK1
+ISR(PCINT1_vect) { pcint_wakeup(); }
+#endif
+#ifdef SUSPEND_WAKEUP_PCMSK2
+ISR(PCINT2_vect) { pcint_wakeup(); }
+#endif
+#endif
+
+/* Timer0 stops in power-down, compensate for sleep time */
+static inline void sleep_compensate(uint8_t wdto, bool partial)
+{
+    uint16_t ms;
+    switch (wdto) {
+        case WDTO_15MS:
+            ms = 15 + 2;    // WDTO_15MS + 2(from observation)
+            break;
+        default:
+            ms = 16U << wdto;   // nominal
+    }
+    if (partial) ms /= 2;
+    timer_count += ms;
+    stats.sleep_ms += ms;
+#ifdef SUSPEND_WAKEUP_PCINT
+    // latency is from pin change, which was before compensation
+    if (partial) pcint_time += (uint32_t)ms * 1000;
+#endif
+}
+
 static void power_down(uint8_t wdto)
 {
 #ifdef PROTOCOL_LUFA
     if (USB_DeviceState == DEVICE_STATE_Configured) return;
 #endif
+#ifdef SUSPEND_WAKEUP_PCINT
+    // key change is not checked by suspend_wakeup_condition() without
+    // remote wakeup, drop it and arm again
+    pcint_woke = false;
+    matrix_wakeup_arm();
+    pcint_enable();
+#endif
+    if (awake_since) stats.awake_us += timer_read_us() - awake_since;
+    stats.sleeps++;
     wdt_timeout = wdto;
+    wdt_woke = false;
 
     // Watchdog Interrupt Mode
     wdt_intr_enable(wdto);
@@ -71,36 +193,98 @@ static void power_down(uint8_t wdto)
     // - BOD disable
     // - Power Reduction Register PRR
     set_sleep_mode(SLEEP_MODE_PWR_DOWN);
-    sleep_enable();
+    cli();
+#ifdef SUSPEND_WAKEUP_PCINT
+    // pin change after arming must not be missed
+    if (!pcint_woke)
+#endif
+    {
+        sleep_enable();
+        sei();
+        sleep_cpu();
+        sleep_disable();
+    }
     sei();
-    sleep_cpu();
-    sleep_disable();
 
     // Disable watchdog after sleep
     wdt_disable();
+#ifdef SUSPEND_WAKEUP_PCINT
+    pcint_disable();
+    matrix_wakeup_disarm();
+    // woken by pin change before watchdog timeout
+    cli();
+    if (!wdt_woke) sleep_compensate(wdto, true);
+    sei();
+#endif
+    awake_since = timer_read_us() | 1;
 }
 
 void suspend_power_down(void)
 {
+#ifdef BOOTMAGIC_ENABLE
+    // host may cut power while suspended
+    eeconfig_flush();
+#endif
+#ifdef SUSPEND_WAKEUP_PCINT
+    power_down(SUSPEND_WAKEUP_WDTO);
+#else
     power_down(WDTO_15MS);
+#endif
 }
 
 __attribute__ ((weak)) void matrix_power_up(void) {}
 __attribute__ ((weak)) void matrix_power_down(void) {}
 bool suspend_wakeup_condition(void)
 {
+#ifdef SUSPEND_WAKEUP_PCINT
+    // no column pin has changed
+    if (!pcint_woke) return false;
+    pcint_woke = false;
+#endif
+    stats.scans++;
     matrix_power_up();
     matrix_scan();
     matrix_power_down();
     for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
-        if (matrix_get_row(r)) return true;
+        if (matrix_get_row(r)) {
+#ifdef SUSPEND_WAKEUP_PCINT
+            uint32_t latency = timer_read_us() - pcint_time;
+            stats.wakes++;
+            stats.wake_latency_sum += latency;
+            if (latency > stats.wake_latency_max) stats.wake_latency_max = latency;
+#endif
+            return true;
+        }
     }
     return false;
 }
 
+static void suspend_print_stats(void)
+{
+#ifndef NO_DEBUG
+    if (!stats.sleeps) return;
+    uint32_t total_us = stats.sleep_ms * 1000 + stats.awake_us;
+    uint32_t ua = SUSPEND_SLEEP_UA;
+    if (total_us) {
+        ua += (uint64_t)(SUSPEND_ACTIVE_UA - SUSPEND_SLEEP_UA) * stats.awake_us / total_us;
+    }
+    dprintf("suspend: %lums %u sleeps %u scans awake %luus\n",
+            total_us / 1000, stats.sleeps, stats.scans, stats.awake_us);
+    dprintf("suspend: current %luuA(est. active %uuA sleep %uuA)\n",
+            ua, SUSPEND_ACTIVE_UA, SUSPEND_SLEEP_UA);
+    if (stats.wakes) {
+        dprintf("suspend: wake latency avg %luus max %luus\n",
+                stats.wake_latency_sum / stats.wakes, stats.wake_latency_max);
+    }
+#endif
+    stats = (typeof(stats)){};
+    awake_since = 0;
+}
+
 // run immediately after wakeup
 void suspend_wakeup_init(void)
 {
+    suspend_print_stats();
     // clear keyboard state
     clear_keyboard();
 #ifdef BACKLIGHT_ENABLE
@@ -113,12 +297,7 @@ void suspend_wakeup_init(void)
 ISR(WDT_vect)
 {
     // compensate timer for sleep
-    switch (wdt_timeout) {
-        case WDTO_15MS:
-            timer_count += 15 + 2;  // WDTO_15MS + 2(from observation)
-            break;
-        default:
-            ;
-    }
+    sleep_compensate(wdt_timeout, false);
+    wdt_woke = true;
 }
 #endif
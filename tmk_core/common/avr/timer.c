@@ -110,6 +110,23 @@ uint32_t timer_elapsed32(uint32_t last)
     return TIMER_DIFF_32(t, last);
 }
 
+/* time in us, wraps around in 71 minutes */
+uint32_t timer_read_us(void)
+{
+    // ms count plus raw count of Timer0
+    uint8_t sreg = SREG;
+    cli();
+    uint32_t ms = timer_count;
+    uint8_t raw = TIMER_RAW;
+    if (TIFR0 & (1<<OCF0A)) {
+        // compare match is pending: counter restarted but ISR has not run
+        ms++;
+        raw = TIMER_RAW;
+    }
+    SREG = sreg;
+    return ms * 1000 + (uint32_t)raw * (1000000UL / TIMER_RAW_FREQ);
+}
+
 // excecuted once per 1ms.(excess for just timer count?)
 ISR(TIMER0_COMPA_vect)
 {
@@ -39,4 +39,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #   error "Timer0 can't count 1ms at this clock freq. Use larger prescaler."
 #endif
 
+/* ms count with resolution of Timer0 raw count */
+uint32_t timer_read_us(void);
+
 #endif
@@ -0,0 +1,31 @@
+#ifndef BACKLIGHT_PWM_H
+#define BACKLIGHT_PWM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* brightness steps of curve table */
+#define BACKLIGHT_PWM_STEPS 64
+
+
+#ifdef BACKLIGHT_PWM_ENABLE
+
+void backlight_pwm_init(void);
+/* fade to step(0-63) in BACKLIGHT_PWM_FADE_MS, from any step */
+void backlight_pwm_fade(uint8_t step);
+/* breathe between off and brightness of backlight level */
+void backlight_pwm_breathing(bool on);
+void backlight_pwm_breathing_toggle(void);
+bool backlight_pwm_is_breathing(void);
+
+#else
+
+#define backlight_pwm_init()
+#define backlight_pwm_fade(step)
+#define backlight_pwm_breathing(on)
+#define backlight_pwm_breathing_toggle()
+#define backlight_pwm_is_breathing()    false
+
+#endif
+
+#endif
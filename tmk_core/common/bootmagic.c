@@ -11,6 +11,13 @@
 #include "bootmagic.h"
 
 
+/* keycodes of layer 0 pressed at startup */
+static uint8_t keycode_pressed[256/8];
+
+static void scan_keycodes(void);
+static bool keycode_is_pressed(uint8_t keycode);
+
+
 void bootmagic(void)
 {
     /* check signature */
@@ -22,6 +29,7 @@ void bootmagic(void)
     print("boogmagic scan: ... ");
     uint8_t scan = 100;
     while (scan--) { matrix_scan(); _delay_ms(10); }
+    scan_keycodes();
     print("done.\n");
 
     /* bootmagic skip */
@@ -105,24 +113,32 @@ void bootmagic(void)
     }
 }
 
-static bool scan_keycode(uint8_t keycode)
+/* read keycode of every pressed key once */
+static void scan_keycodes(void)
 {
+    for (uint8_t i = 0; i < sizeof(keycode_pressed); i++) {
+        keycode_pressed[i] = 0;
+    }
     for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
         matrix_row_t matrix_row = matrix_get_row(r);
-        for (uint8_t c = 0; c < MATRIX_COLS; c++) {
-            if (matrix_row & ((matrix_row_t)1<<c)) {
-                if (keycode == keymap_key_to_keycode(0, (keypos_t){ .row = r, .col = c })) {
-                    return true;
-                }
+        for (uint8_t c = 0; matrix_row; c++, matrix_row >>= 1) {
+            if (matrix_row & 1) {
+                uint8_t keycode = keymap_key_to_keycode(0, (keypos_t){ .row = r, .col = c });
+                keycode_pressed[keycode>>3] |= (1<<(keycode&7));
             }
         }
     }
-    return false;
 }
 
+static bool keycode_is_pressed(uint8_t keycode)
+{
+    return keycode_pressed[keycode>>3] & (1<<(keycode&7));
+}
+
+/* NOTE: answers from keys pressed when bootmagic() scanned matrix */
 bool bootmagic_scan_keycode(uint8_t keycode)
 {
-    if (!scan_keycode(BOOTMAGIC_KEY_SALT)) return false;
+    if (!keycode_is_pressed(BOOTMAGIC_KEY_SALT)) return false;
 
-    return scan_keycode(keycode);
+    return keycode_is_pressed(keycode);
 }
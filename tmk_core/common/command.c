@@ -33,6 +33,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "led.h"
 #include "command.h"
 #include "backlight.h"
+#include "latency.h"
+#include "event_trace.h"
 
 #ifdef MOUSEKEY_ENABLE
 #include "mousekey.h"
@@ -138,6 +140,14 @@ static void command_common_help(void)
 #ifdef SLEEP_LED_ENABLE
           "z:	sleep LED test\n"
 #endif
+
+#ifdef LATENCY_ENABLE
+          "l:	latency(and clear)\n"
+#endif
+
+#ifdef EVENT_TRACE_ENABLE
+          "t:	event trace\n"
+#endif
     );
 }
 
@@ -188,6 +198,17 @@ static bool command_common(uint8_t code)
             led_set(host_keyboard_leds());
             break;
 #endif
+#ifdef LATENCY_ENABLE
+        case KC_L:
+            latency_print();
+            latency_clear();
+            break;
+#endif
+#ifdef EVENT_TRACE_ENABLE
+        case KC_T:
+            event_trace_dump();
+            break;
+#endif
 #ifdef BOOTMAGIC_ENABLE
         case KC_E:
             print("eeconfig:\n");
@@ -223,6 +244,9 @@ static bool command_common(uint8_t code)
         case KC_PAUSE:
             clear_keyboard();
             print("\n\nbootloader... ");
+#ifdef BOOTMAGIC_ENABLE
+            eeconfig_flush();
+#endif
             _delay_ms(1000);
             bootloader_jump(); // not return
             break;
@@ -303,6 +327,9 @@ static bool command_common(uint8_t code)
 #endif
 #ifdef KEYMAP_SECTION_ENABLE
             " KEYMAP_SECTION"
+#endif
+#ifdef LATENCY_ENABLE
+            " LATENCY"
 #endif
             " " STR(BOOTLOADER_SIZE) "\n");
 
@@ -316,6 +343,15 @@ static bool command_common(uint8_t code)
             print_val_hex8(keyboard_protocol);
             print_val_hex8(keyboard_idle);
             print_val_hex32(timer_count);
+            print_val_dec(keyboard_startup_time);
+            xprintf("keyboard reports: %lu sent, %lu suppressed\n",
+                    host_report_stats.keyboard.sent, host_report_stats.keyboard.suppressed);
+            xprintf("mouse reports: %lu sent, %lu suppressed\n",
+                    host_report_stats.mouse.sent, host_report_stats.mouse.suppressed);
+#ifdef KEYBOARD_IDLE_TIMEOUT
+            xprintf("scans/s: active %u, idle %u\n",
+                    keyboard_scan_rate(KEYBOARD_SCAN_ACTIVE), keyboard_scan_rate(KEYBOARD_SCAN_IDLE));
+#endif
 
 #ifdef PROTOCOL_PJRC
             print_val_hex8(UDCON);
@@ -333,8 +369,7 @@ static bool command_common(uint8_t code)
             break;
 #ifdef NKRO_ENABLE
         case KC_N:
-            clear_keyboard(); //Prevents stuck keys.
-            keyboard_nkro = !keyboard_nkro;
+            set_keyboard_nkro(!keyboard_nkro);
             if (keyboard_nkro)
                 print("NKRO: on\n");
             else
@@ -0,0 +1,122 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "matrix.h"
+#include "timer.h"
+#include "util.h"
+#include "debounce.h"
+
+
+#if (MATRIX_COLS <= 8)
+#   define ROW_CTZ(bits)    bitctz(bits)
+#elif (MATRIX_COLS <= 16)
+#   define ROW_CTZ(bits)    bitctz16(bits)
+#else
+#   define ROW_CTZ(bits)    bitctz32(bits)
+#endif
+
+/* Keys under debouncing: locked keys(eager) or keys waiting for stable state(deferred) */
+static matrix_row_t debouncing[MATRIX_ROWS];
+/* time of last edge per key(lower 8 bits of ms timer) */
+static uint8_t debounce_time[MATRIX_ROWS][MATRIX_COLS];
+#ifndef DEBOUNCE_EAGER
+static matrix_row_t raw_prev[MATRIX_ROWS];
+#endif
+
+#define ELAPSED(now, t)     ((uint8_t)((now) - (t)))
+
+
+void debounce_init(void)
+{
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        debouncing[r] = 0;
+#ifndef DEBOUNCE_EAGER
+        raw_prev[r] = 0;
+#endif
+    }
+}
+
+bool debounce_active(void)
+{
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        if (debouncing[r]) return true;
+    }
+    return false;
+}
+
+#if DEBOUNCE == 0
+bool debounce_update(const matrix_row_t raw[], matrix_row_t cooked[])
+{
+    bool changed = false;
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        if (cooked[r] != raw[r]) {
+            cooked[r] = raw[r];
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+#elif defined(DEBOUNCE_EAGER)
+bool debounce_update(const matrix_row_t raw[], matrix_row_t cooked[])
+{
+    bool changed = false;
+    uint8_t now = timer_read();
+
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        // unlock keys whose lockout period has passed
+        matrix_row_t locked = debouncing[r];
+        while (locked) {
+            uint8_t c = ROW_CTZ(locked);
+            if (ELAPSED(now, debounce_time[r][c]) >= DEBOUNCE) {
+                debouncing[r] &= ~(matrix_row_t)(locked & -locked);
+            }
+            locked &= locked - 1;
+        }
+
+        // report first edge at once and lock the key out
+        matrix_row_t change = (raw[r] ^ cooked[r]) & ~debouncing[r];
+        if (change) {
+            cooked[r] ^= change;
+            debouncing[r] |= change;
+            changed = true;
+            while (change) {
+                debounce_time[r][ROW_CTZ(change)] = now;
+                change &= change - 1;
+            }
+        }
+    }
+    return changed;
+}
+
+#else
+bool debounce_update(const matrix_row_t raw[], matrix_row_t cooked[])
+{
+    bool changed = false;
+    uint8_t now = timer_read();
+
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        // restart timer of keys which changed in this scan
+        matrix_row_t edge = raw[r] ^ raw_prev[r];
+        raw_prev[r] = raw[r];
+        while (edge) {
+            debounce_time[r][ROW_CTZ(edge)] = now;
+            edge &= edge - 1;
+        }
+
+        // settle keys which have been stable for DEBOUNCE ms
+        matrix_row_t pending = raw[r] ^ cooked[r];
+        debouncing[r] = pending;
+        while (pending) {
+            uint8_t c = ROW_CTZ(pending);
+            if (ELAPSED(now, debounce_time[r][c]) >= DEBOUNCE) {
+                matrix_row_t bit = (matrix_row_t)(pending & -pending);
+                cooked[r] ^= bit;
+                debouncing[r] &= ~bit;
+                changed = true;
+            }
+            pending &= pending - 1;
+        }
+    }
+    return changed;
+}
+#endif
@@ -0,0 +1,41 @@
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "matrix.h"
+
+
+/* debounce time(ms), set 0 if debouncing isn't needed. must be less than 128 */
+#ifndef DEBOUNCE
+#   define DEBOUNCE 5
+#endif
+
+/* Per-key debounce algorithms
+ *
+ * deferred(default):   change of a key is reported after the key has been
+ *                      stable for DEBOUNCE ms.
+ * eager:               first edge of a key is reported at once and the key
+ *                      ignores further changes for DEBOUNCE ms.
+ *                      Define DEBOUNCE_EAGER in config.h to select this.
+ *
+ * Each key has its own timer, so a chattering switch doesn't delay other keys.
+ * Nothing blocks; matrix_scan() just calls debounce_update() every scan.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void debounce_init(void);
+/* raw: rows read in this scan, cooked: debounced rows updated in place.
+ * returns true when cooked is changed. */
+bool debounce_update(const matrix_row_t raw[], matrix_row_t cooked[]);
+/* whether any key is still being debounced */
+bool debounce_active(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
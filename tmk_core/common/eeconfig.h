@@ -22,7 +22,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdbool.h>
 
 
-#define EECONFIG_MAGIC_NUMBER                       (uint16_t)0xFEED
+#define EECONFIG_MAGIC_NUMBER                       (uint16_t)0xFEE1
+/* old layout: a parameter per fixed address, migrated on load */
+#define EECONFIG_MAGIC_NUMBER_V0                    (uint16_t)0xFEED
 
 /* eeprom parameteter address */
 #define EECONFIG_MAGIC                              (uint16_t *)0
@@ -32,6 +34,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define EECONFIG_MOUSEKEY_ACCEL                     (uint8_t *)5
 #define EECONFIG_BACKLIGHT                          (uint8_t *)6
 
+/* ring of parameter records, 8 bytes each */
+#define EECONFIG_SLOT_BASE                          (uint8_t *)8
+#ifndef EECONFIG_SLOTS
+#define EECONFIG_SLOTS                              8
+#endif
+
+/* ms without change before parameters are written to eeprom */
+#ifndef EECONFIG_COMMIT_DELAY
+#define EECONFIG_COMMIT_DELAY                       5000
+#endif
+
 
 /* debug bit */
 #define EECONFIG_DEBUG_ENABLE                       (1<<0)
@@ -72,4 +85,13 @@ uint8_t eeconfig_read_backlight(void);
 void eeconfig_write_backlight(uint8_t val);
 #endif
 
+/* read newest record into RAM, done on first access */
+void eeconfig_load(void);
+
+/* write changed parameters when EECONFIG_COMMIT_DELAY has passed */
+void eeconfig_task(void);
+
+/* write changed parameters now, before reset or power down */
+void eeconfig_flush(void);
+
 #endif
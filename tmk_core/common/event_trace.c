@@ -0,0 +1,131 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+#include "print.h"
+#include "event_trace.h"
+
+
+static event_trace_t ring[EVENT_TRACE_SIZE];
+static uint16_t head = 0;       /* next record to write */
+static uint16_t count = 0;
+
+
+static void record(uint8_t type, uint8_t a, uint8_t b, uint16_t time)
+{
+    ring[head] = (event_trace_t){ .type = type, .a = a, .b = b, .time = time };
+    head = (head + 1) % EVENT_TRACE_SIZE;
+    if (count < EVENT_TRACE_SIZE) count++;
+}
+
+void event_trace_key(keyevent_t event)
+{
+    if (IS_NOEVENT(event)) return;
+    // not event.time, which may be off by 1ms to be non-zero
+    record(EVENT_TRACE_KEY | (event.pressed ? EVENT_TRACE_PRESSED : 0),
+           event.key.row, event.key.col, timer_read());
+}
+
+static bool report_has_key(const report_keyboard_t *report, uint8_t code)
+{
+    for (uint8_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
+        if (report->keys[i] == code) return true;
+    }
+    return false;
+}
+
+/* keys in a but not in b */
+static void keys_diff(const report_keyboard_t *a, const report_keyboard_t *b, bool nkro,
+                      uint8_t type, uint16_t time)
+{
+#ifdef NKRO_ENABLE
+    if (nkro) {
+        for (uint8_t i = 0; i < KEYBOARD_REPORT_BITS; i++) {
+            uint8_t bits = a->nkro.bits[i] & ~(b ? b->nkro.bits[i] : 0);
+            for (uint8_t j = 0; bits; j++, bits >>= 1) {
+                if (bits & 1) record(type, i<<3 | j, 0, time);
+            }
+        }
+        return;
+    }
+#endif
+    for (uint8_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
+        uint8_t code = a->keys[i];
+        if (code && !(b && report_has_key(b, code))) record(type, code, 0, time);
+    }
+}
+
+void event_trace_report(const report_keyboard_t *prev, const report_keyboard_t *report, bool nkro)
+{
+    uint16_t time = timer_read();
+    if (report->mods != (prev ? prev->mods : 0)) {
+        record(EVENT_TRACE_REPORT_MODS, report->mods, 0, time);
+    }
+    if (prev) keys_diff(prev, report, nkro, EVENT_TRACE_REPORT_KEY, time);
+    keys_diff(report, prev, nkro, EVENT_TRACE_REPORT_KEY | EVENT_TRACE_PRESSED, time);
+}
+
+uint16_t event_trace_count(void)
+{
+    return count;
+}
+
+event_trace_t event_trace_get(uint16_t i)
+{
+    return ring[(head + EVENT_TRACE_SIZE - count + i) % EVENT_TRACE_SIZE];
+}
+
+void event_trace_clear(void)
+{
+    head = 0;
+    count = 0;
+}
+
+/* key released in trace without press before it was held when trace starts */
+static bool held_at_start(uint16_t n, event_trace_t r)
+{
+    if ((r.type & ~EVENT_TRACE_PRESSED) != EVENT_TRACE_KEY || (r.type & EVENT_TRACE_PRESSED)) {
+        return false;
+    }
+    for (uint16_t i = 0; i < n; i++) {
+        event_trace_t p = event_trace_get(i);
+        if (p.type == (EVENT_TRACE_KEY | EVENT_TRACE_PRESSED) && p.a == r.a && p.b == r.b) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Prints trace for keyboard/sim. Time starts at 1000ms so that keys held
+ * before the trace can be pressed at 0 and settle before the first record.
+ */
+void event_trace_dump(void)
+{
+    xprintf("# event trace: %u records\n", count);
+    for (uint16_t i = 0; i < count; i++) {
+        event_trace_t r = event_trace_get(i);
+        if (held_at_start(i, r)) {
+            xprintf("0 %u %u d  # held\n", r.a, r.b);
+        }
+    }
+
+    uint32_t t = 1000;
+    uint16_t prev = count ? event_trace_get(0).time : 0;
+    for (uint16_t i = 0; i < count; i++) {
+        event_trace_t r = event_trace_get(i);
+        t += (uint16_t)(r.time - prev);
+        prev = r.time;
+        char ud = (r.type & EVENT_TRACE_PRESSED) ? 'd' : 'u';
+        switch (r.type & ~EVENT_TRACE_PRESSED) {
+            case EVENT_TRACE_KEY:
+                xprintf("%lu %u %u %c\n", (unsigned long)t, r.a, r.b, ud);
+                break;
+            case EVENT_TRACE_REPORT_KEY:
+                xprintf("%lu k %02X %c\n", (unsigned long)t, r.a, ud);
+                break;
+            case EVENT_TRACE_REPORT_MODS:
+                xprintf("%lu m %02X\n", (unsigned long)t, r.a);
+                break;
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef EVENT_TRACE_H
+#define EVENT_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "keyboard.h"
+#include "report.h"
+
+
+/*
+ * Event trace
+ *
+ * Key events going into action_exec() and changes of keyboard report sent to
+ * host are recorded in a ring of EVENT_TRACE_SIZE records, the oldest are
+ * overwritten. Recording is a few stores without print, so that timing of
+ * tapping is not disturbed. Dump is in trace format of keyboard/sim and can
+ * be replayed there to check that it produces same reports.
+ */
+/* record type */
+#define EVENT_TRACE_KEY         0   /* a: row, b: col */
+#define EVENT_TRACE_REPORT_KEY  1   /* a: keycode */
+#define EVENT_TRACE_REPORT_MODS 2   /* a: mods */
+#define EVENT_TRACE_PRESSED     0x80
+
+typedef struct {
+    uint8_t  type;
+    uint8_t  a;
+    uint8_t  b;
+    uint16_t time;
+} event_trace_t;
+
+
+#ifdef EVENT_TRACE_ENABLE
+
+#ifndef EVENT_TRACE_SIZE
+#define EVENT_TRACE_SIZE    32
+#endif
+
+void event_trace_key(keyevent_t event);
+/* prev is NULL when host doesn't know previous report */
+void event_trace_report(const report_keyboard_t *prev, const report_keyboard_t *report, bool nkro);
+/* i: 0 is the oldest */
+uint16_t event_trace_count(void);
+event_trace_t event_trace_get(uint16_t i);
+void event_trace_clear(void);
+void event_trace_dump(void);
+
+#else
+
+#define event_trace_key(event)
+#define event_trace_report(prev, report, nkro)
+#define event_trace_clear()
+#define event_trace_dump()
+
+#endif
+
+#endif
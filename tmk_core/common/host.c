@@ -16,25 +16,41 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include <stdint.h>
+#include <string.h>
 //#include <avr/interrupt.h>
 #include "keycode.h"
 #include "host.h"
 #include "util.h"
 #include "debug.h"
+#include "event_trace.h"
 
 
 #ifdef NKRO_ENABLE
 bool keyboard_nkro = true;
 #endif
 
+host_report_stats_t host_report_stats;
+
 static host_driver_t *driver;
 static uint16_t last_system_report = 0;
 static uint16_t last_consumer_report = 0;
 
+/* last reports transmitted to driver */
+static report_keyboard_t last_keyboard_report;
+static report_mouse_t last_mouse_report;
+static bool last_keyboard_valid = false;
+static bool last_mouse_valid = false;
+#ifdef NKRO_ENABLE
+static bool last_keyboard_nkro;
+#endif
+
 
 void host_set_driver(host_driver_t *d)
 {
     driver = d;
+    /* new host doesn't know previous reports */
+    last_keyboard_valid = false;
+    last_mouse_valid = false;
 }
 
 host_driver_t *host_get_driver(void)
@@ -47,10 +63,37 @@ uint8_t host_keyboard_leds(void)
     if (!driver) return 0;
     return (*driver->keyboard_leds)();
 }
+bool host_keyboard_ready(void)
+{
+    if (!driver || !driver->keyboard_ready) return true;
+    return (*driver->keyboard_ready)();
+}
+
 /* send report */
 void host_keyboard_send(report_keyboard_t *report)
 {
     if (!driver) return;
+
+    if (last_keyboard_valid &&
+#ifdef NKRO_ENABLE
+            last_keyboard_nkro == keyboard_nkro &&
+#endif
+            memcmp(&last_keyboard_report, report, sizeof(report_keyboard_t)) == 0) {
+        host_report_stats.keyboard.suppressed++;
+        return;
+    }
+#ifdef NKRO_ENABLE
+    event_trace_report(last_keyboard_valid ? &last_keyboard_report : NULL, report, keyboard_nkro);
+#else
+    event_trace_report(last_keyboard_valid ? &last_keyboard_report : NULL, report, false);
+#endif
+    last_keyboard_report = *report;
+    last_keyboard_valid = true;
+#ifdef NKRO_ENABLE
+    last_keyboard_nkro = keyboard_nkro;
+#endif
+
+    host_report_stats.keyboard.sent++;
     (*driver->send_keyboard)(report);
 
     if (debug_keyboard) {
@@ -65,9 +108,34 @@ void host_keyboard_send(report_keyboard_t *report)
 void host_mouse_send(report_mouse_t *report)
 {
     if (!driver) return;
+
+    /* movement is relative, only report without movement can be redundant */
+    if (last_mouse_valid && !report->x && !report->y && !report->v && !report->h &&
+            memcmp(&last_mouse_report, report, sizeof(report_mouse_t)) == 0) {
+        host_report_stats.mouse.suppressed++;
+        return;
+    }
+    last_mouse_report = *report;
+    last_mouse_valid = true;
+
+    host_report_stats.mouse.sent++;
     (*driver->send_mouse)(report);
 }
 
+/* driver couldn't deliver a report it was given, so it is not counted as sent
+ * and same report must not be suppressed next */
+void host_keyboard_unsent(void)
+{
+    last_keyboard_valid = false;
+    if (host_report_stats.keyboard.sent) host_report_stats.keyboard.sent--;
+}
+
+void host_mouse_unsent(void)
+{
+    last_mouse_valid = false;
+    if (host_report_stats.mouse.sent) host_report_stats.mouse.sent--;
+}
+
 void host_system_send(uint16_t report)
 {
     if (report == last_system_report) return;
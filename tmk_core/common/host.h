@@ -35,6 +35,19 @@ extern bool keyboard_nkro;
 extern uint8_t keyboard_idle;
 extern uint8_t keyboard_protocol;
 
+/* number of reports delivered by driver and collapsed as redundant */
+typedef struct {
+    uint32_t sent;
+    uint32_t suppressed;
+} host_report_count_t;
+
+typedef struct {
+    host_report_count_t keyboard;
+    host_report_count_t mouse;
+} host_report_stats_t;
+
+extern host_report_stats_t host_report_stats;
+
 
 /* host driver */
 void host_set_driver(host_driver_t *driver);
@@ -42,11 +55,17 @@ host_driver_t *host_get_driver(void);
 
 /* host driver interface */
 uint8_t host_keyboard_leds(void);
+bool host_keyboard_ready(void);
 void host_keyboard_send(report_keyboard_t *report);
 void host_mouse_send(report_mouse_t *report);
 void host_system_send(uint16_t data);
 void host_consumer_send(uint16_t data);
 
+/* called by driver once for each report dropped in send_keyboard/send_mouse
+ * or discarded later from its queue */
+void host_keyboard_unsent(void);
+void host_mouse_unsent(void);
+
 uint16_t host_last_sysytem_report(void);
 uint16_t host_last_consumer_report(void);
 
@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define HOST_DRIVER_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "report.h"
 
 
@@ -28,6 +29,8 @@ typedef struct {
     void (*send_mouse)(report_mouse_t *);
     void (*send_system)(uint16_t);
     void (*send_consumer)(uint16_t);
+    /* optional: keyboard report can be sent without superseding pending one */
+    bool (*keyboard_ready)(void);
 } host_driver_t;
 
 #endif
@@ -19,6 +19,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "matrix.h"
 #include "keymap.h"
 #include "host.h"
+#include "action_util.h"
+#include "action_macro.h"
 #include "led.h"
 #include "keycode.h"
 #include "timer.h"
@@ -30,6 +32,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "bootmagic.h"
 #include "eeconfig.h"
 #include "backlight.h"
+#include "latency.h"
+#include "suspend.h"
 #ifdef MOUSEKEY_ENABLE
 #   include "mousekey.h"
 #endif
@@ -62,15 +66,19 @@ static bool has_ghost_in_row(uint8_t row)
 #endif
 
 
+uint16_t keyboard_startup_time = 0;
+
+
 __attribute__ ((weak)) void matrix_setup(void) {}
 void keyboard_setup(void)
 {
+    // start timer as early as possible to measure startup time
+    timer_init();
     matrix_setup();
 }
 
 void keyboard_init(void)
 {
-    timer_init();
     matrix_init();
 #ifdef PS2_MOUSE_ENABLE
     ps2_mouse_init();
@@ -93,25 +101,76 @@ void keyboard_init(void)
 }
 
 /*
- * Do keyboard routine jobs: scan mantrix, light LEDs, ...
- * This is repeatedly called as fast as possible.
+ * Key event queue
+ *
+ * Every key change found in a matrix scan is queued with one shared timestamp
+ * and the whole queue is drained through action_exec() in the same task call,
+ * so a chord reaches host in one scan instead of one scan per key.
+ * Changes which don't fit in the queue remain in matrix diff and are picked
+ * up by next task call.
  */
-void keyboard_task(void)
+static keyevent_t event_queue[KEYBOARD_EVENT_QUEUE_SIZE];
+static uint8_t event_queue_count = 0;
+
+static inline bool event_queue_enq(keyevent_t event)
+{
+    if (event_queue_count >= KEYBOARD_EVENT_QUEUE_SIZE) return false;
+    event_queue[event_queue_count++] = event;
+    return true;
+}
+
+/*
+ * Matrix diff
+ *
+ * Change masks of all rows are computed at once and rows with change are
+ * marked in dirty bitmap. Changed keys are extracted with count-trailing-zeros
+ * so that cost is proportional to number of changes, not MATRIX_ROWS*MATRIX_COLS.
+ */
+#if (MATRIX_COLS <= 8)
+#   define MATRIX_ROW_CTZ(bits)     bitctz(bits)
+#elif (MATRIX_COLS <= 16)
+#   define MATRIX_ROW_CTZ(bits)     bitctz16(bits)
+#else
+#   define MATRIX_ROW_CTZ(bits)     bitctz32(bits)
+#endif
+
+static matrix_row_t matrix_prev[MATRIX_ROWS];
+static matrix_row_t matrix_change[MATRIX_ROWS];
+static uint8_t matrix_dirty[(MATRIX_ROWS + 7) / 8];
+
+static inline void matrix_diff(void)
+{
+    for (uint8_t i = 0; i < sizeof(matrix_dirty); i++) {
+        matrix_dirty[i] = 0;
+    }
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        matrix_change[r] = matrix_get_row(r) ^ matrix_prev[r];
+        if (matrix_change[r]) {
+            matrix_dirty[r>>3] |= (1<<(r&7));
+        }
+    }
+}
+
+/* Scan matrix and process key events */
+static void keyboard_scan(void)
 {
-    static matrix_row_t matrix_prev[MATRIX_ROWS];
 #ifdef MATRIX_HAS_GHOST
     static matrix_row_t matrix_ghost[MATRIX_ROWS];
 #endif
-    static uint8_t led_status = 0;
-    matrix_row_t matrix_row = 0;
-    matrix_row_t matrix_change = 0;
 
     matrix_scan();
-    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
-        matrix_row = matrix_get_row(r);
-        matrix_change = matrix_row ^ matrix_prev[r];
-        if (matrix_change) {
+    matrix_diff();
+    // events detected in this scan share timestamp
+    uint16_t time = (timer_read() | 1); /* time should not be 0 */
+    event_queue_count = 0;
+    for (uint8_t i = 0; i < sizeof(matrix_dirty); i++) {
+        uint8_t dirty = matrix_dirty[i];
+        while (dirty) {
+            uint8_t r = (i<<3) + bitctz(dirty);
+            dirty &= dirty - 1;
+            matrix_row_t matrix_change_row = matrix_change[r];
 #ifdef MATRIX_HAS_GHOST
+            matrix_row_t matrix_row = matrix_get_row(r);
             if (has_ghost_in_row(r)) {
                 /* Keep track of whether ghosted status has changed for
                  * debugging. But don't update matrix_prev until un-ghosted, or
@@ -126,25 +185,139 @@ void keyboard_task(void)
             matrix_ghost[r] = matrix_row;
 #endif
             if (debug_matrix) matrix_print();
-            for (uint8_t c = 0; c < MATRIX_COLS; c++) {
-                if (matrix_change & ((matrix_row_t)1<<c)) {
-                    action_exec((keyevent_t){
-                        .key = (keypos_t){ .row = r, .col = c },
-                        .pressed = (matrix_row & ((matrix_row_t)1<<c)),
-                        .time = (timer_read() | 1) /* time should not be 0 */
-                    });
-                    // record a processed key
-                    matrix_prev[r] ^= ((matrix_row_t)1<<c);
-                    // process a key per task call
+            while (matrix_change_row) {
+                uint8_t c = MATRIX_ROW_CTZ(matrix_change_row);
+                matrix_row_t col_bit = (matrix_row_t)(matrix_change_row & -matrix_change_row);
+                if (!event_queue_enq((keyevent_t){
+                    .key = (keypos_t){ .row = r, .col = c },
+                    .pressed = !(matrix_prev[r] & col_bit),
+                    .time = time
+                })) {
+                    // queue is full: rest of changes wait for next call
                     goto MATRIX_LOOP_END;
                 }
+                // record a queued key
+                matrix_prev[r] ^= col_bit;
+                matrix_change_row &= matrix_change_row - 1;
             }
         }
     }
-    // call with pseudo tick event when no real key event.
-    action_exec(TICK);
 
 MATRIX_LOOP_END:
+    if (event_queue_count) {
+        latency_scan();
+        // process all key events of this scan
+        for (uint8_t i = 0; i < event_queue_count; i++) {
+            action_exec(event_queue[i]);
+        }
+    } else if (action_tick_due(time)) {
+        // call with pseudo tick event only when a tap key is due to settle
+        action_exec(TICK);
+    }
+}
+
+/*
+ * Scan scheduler
+ *
+ * Matrix is scanned on every call while keyboard is active and until
+ * KEYBOARD_IDLE_TIMEOUT ms passes without activity. In idle state it is
+ * scanned every KEYBOARD_IDLE_SCAN_INTERVAL ms and MCU sleeps in idle mode
+ * between calls until next interrupt(1ms timer tick at latest). Any change
+ * found in idle scan switches back to full rate at once.
+ */
+#ifdef KEYBOARD_IDLE_TIMEOUT
+#ifndef KEYBOARD_IDLE_SCAN_INTERVAL
+#define KEYBOARD_IDLE_SCAN_INTERVAL 10
+#endif
+
+static uint8_t scan_state = KEYBOARD_SCAN_ACTIVE;
+static uint32_t scan_state_since = 0;
+static uint32_t scan_last = 0;
+static uint32_t scan_last_active = 0;
+static uint32_t scan_count[KEYBOARD_SCAN_STATES];
+static uint32_t scan_time[KEYBOARD_SCAN_STATES];
+
+/* key changed or is down, or tap is pending */
+static bool scan_is_active(void)
+{
+    if (event_queue_count || action_pending()) return true;
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        if (matrix_prev[r]) return true;
+    }
+    return false;
+}
+
+static void scan_state_set(uint8_t state, uint32_t now)
+{
+    scan_time[scan_state] += now - scan_state_since;
+    scan_state_since = now;
+    scan_state = state;
+    dprintf("scan: %s\n", state == KEYBOARD_SCAN_IDLE ? "idle" : "active");
+}
+
+static void scan_schedule(void)
+{
+    uint32_t now = timer_read32();
+    if (scan_state == KEYBOARD_SCAN_IDLE &&
+            TIMER_DIFF_32(now, scan_last) < KEYBOARD_IDLE_SCAN_INTERVAL) {
+        return;
+    }
+    scan_last = now;
+    scan_count[scan_state]++;
+
+    keyboard_scan();
+    if (scan_is_active()) {
+        scan_last_active = now;
+        if (scan_state == KEYBOARD_SCAN_IDLE) {
+            scan_state_set(KEYBOARD_SCAN_ACTIVE, now);
+        }
+    } else if (scan_state == KEYBOARD_SCAN_ACTIVE &&
+            TIMER_DIFF_32(now, scan_last_active) >= KEYBOARD_IDLE_TIMEOUT) {
+        scan_state_set(KEYBOARD_SCAN_IDLE, now);
+    }
+}
+
+uint16_t keyboard_scan_rate(uint8_t state)
+{
+    uint32_t time = scan_time[state];
+    if (state == scan_state) {
+        time += timer_read32() - scan_state_since;
+    }
+    if (!time) return 0;
+    uint32_t count = scan_count[state];
+    uint32_t rate;
+    if (count <= UINT32_MAX / 1000) {
+        rate = count * 1000 / time;
+    } else {
+        // count * 1000 overflows 32 bits after 4.3M scans, scale time instead
+        if (time < 1000) return UINT16_MAX;
+        rate = count / (time / 1000);
+    }
+    return rate > UINT16_MAX ? UINT16_MAX : rate;
+}
+#endif
+
+/*
+ * Do keyboard routine jobs: scan mantrix, light LEDs, ...
+ * This is repeatedly called as fast as possible.
+ */
+void keyboard_task(void)
+{
+    static uint8_t led_status = 0;
+
+    if (!keyboard_startup_time) {
+        keyboard_startup_time = timer_read() | 1;
+        dprintf("startup: %u ms\n", keyboard_startup_time);
+    }
+
+#ifdef KEYBOARD_IDLE_TIMEOUT
+    scan_schedule();
+#else
+    keyboard_scan();
+#endif
+
+    // play next step of macros
+    action_macro_task();
 
 #ifdef MOUSEKEY_ENABLE
     // mousekey repeat & acceleration
@@ -163,11 +336,32 @@ MATRIX_LOOP_END:
         adb_mouse_task();
 #endif
 
+#ifdef BOOTMAGIC_ENABLE
+    // write changed settings to eeprom
+    eeconfig_task();
+#endif
+
     // update LED
     if (led_status != host_keyboard_leds()) {
         led_status = host_keyboard_leds();
         keyboard_set_leds(led_status);
     }
+
+#ifdef NKRO_ENABLE
+    // protocol set by host, driver may change it in interrupt
+    static uint8_t protocol = 1;
+    if (protocol != keyboard_protocol) {
+        protocol = keyboard_protocol;
+        set_keyboard_nkro(protocol);
+    }
+#endif
+
+#ifdef KEYBOARD_IDLE_TIMEOUT
+    // sleep until next interrupt
+    if (scan_state == KEYBOARD_SCAN_IDLE) {
+        suspend_idle(0);
+    }
+#endif
 }
 
 void keyboard_set_leds(uint8_t leds)
@@ -39,6 +39,11 @@ typedef struct {
     uint16_t time;
 } keyevent_t;
 
+/* max number of key events processed per keyboard_task() call */
+#ifndef KEYBOARD_EVENT_QUEUE_SIZE
+#define KEYBOARD_EVENT_QUEUE_SIZE   8
+#endif
+
 /* equivalent test of keypos_t */
 #define KEYEQ(keya, keyb)       ((keya).row == (keyb).row && (keya).col == (keyb).col)
 
@@ -67,6 +72,20 @@ void keyboard_task(void);
 /* it runs when host LED status is updated */
 void keyboard_set_leds(uint8_t leds);
 
+/* time(ms) from keyboard_setup() to first keyboard_task() */
+extern uint16_t keyboard_startup_time;
+
+#ifdef KEYBOARD_IDLE_TIMEOUT
+/* states of scan scheduler */
+enum {
+    KEYBOARD_SCAN_ACTIVE = 0,
+    KEYBOARD_SCAN_IDLE,
+    KEYBOARD_SCAN_STATES
+};
+/* matrix scans per second in the state, average since startup */
+uint16_t keyboard_scan_rate(uint8_t state);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,28 @@
+#include <stdint.h>
+#include "keycode.h"
+#include "keymap.h"
+#include "util.h"
+#include "keymap_packed.h"
+
+
+/* replaces keymap_key_to_keycode() of keyboard */
+uint8_t keymap_key_to_keycode(uint8_t layer, keypos_t key)
+{
+    // layer which keymap doesn't have falls through
+    if (layer >= pgm_read_byte(&keymap_packed_layers)) return KC_TRNS;
+
+    const uint8_t *row = keymap_packed_rows[layer][key.row];
+    uint8_t byte = key.col / 8;
+    uint8_t mask = 1 << (key.col % 8);
+    uint8_t bits = pgm_read_byte(&row[1 + byte]);
+    if (!(bits & mask)) {
+        return pgm_read_byte(&keymap_packed_fill[layer]);
+    }
+
+    uint16_t i = pgm_read_word(&keymap_packed_base[layer]) + pgm_read_byte(&row[0]);
+    for (uint8_t b = 0; b < byte; b++) {
+        i += bitpop(pgm_read_byte(&row[1 + b]));
+    }
+    i += bitpop(bits & (mask - 1));
+    return pgm_read_byte(&keymap_packed_codes[i]);
+}
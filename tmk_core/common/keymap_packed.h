@@ -0,0 +1,27 @@
+#ifndef KEYMAP_PACKED_H
+#define KEYMAP_PACKED_H
+
+#include <stdint.h>
+#include "progmem.h"
+
+/*
+ * Packed keymap
+ *
+ * Alternative storage of keymaps[] generated by tool/keymap_pack. Each layer
+ * keeps only keycodes which differ from its fill keycode, the most common
+ * one in the layer(usually KC_TRNS or KC_NO).
+ *
+ * Row record is offset of its first keycode in layer followed by bitmap of
+ * stored columns, LSB first. Keycode index is offset plus number of bits
+ * below the column, so lookup reads a fixed number of bytes whatever the
+ * layer holds.
+ */
+#define KEYMAP_PACKED_ROW_SIZE  (1 + (MATRIX_COLS + 7) / 8)
+
+extern const uint8_t keymap_packed_layers;
+extern const uint8_t keymap_packed_fill[];
+extern const uint16_t keymap_packed_base[];
+extern const uint8_t keymap_packed_rows[][MATRIX_ROWS][KEYMAP_PACKED_ROW_SIZE];
+extern const uint8_t keymap_packed_codes[];
+
+#endif
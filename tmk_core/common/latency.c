@@ -0,0 +1,133 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+#include "print.h"
+#include "latency.h"
+
+#if defined(PROTOCOL_SIM)
+#   include "sim/timer_sim.h"
+#endif
+
+
+/* time in us, wraps around in 71 minutes */
+static uint32_t latency_now(void)
+{
+#if defined(__AVR__)
+    return timer_read_us();
+#elif defined(PROTOCOL_SIM)
+    return (uint32_t)timer_sim_read_us();
+#else
+    return timer_read32() * 1000;
+#endif
+}
+
+
+typedef struct {
+    uint32_t min;
+    uint32_t max;
+} latency_range_t;
+
+enum {
+    STAGE_SCAN_ACTION = 0,
+    STAGE_ACTION_SEND,
+    STAGE_SCAN_SEND,
+    STAGES
+};
+
+#define PENDING_SCAN    (1<<0)
+#define PENDING_ACTION  (1<<1)
+
+static uint8_t pending = 0;
+static uint32_t scan_time;
+static uint32_t action_time;
+
+static uint16_t count = 0;
+static latency_range_t range[STAGES] = { [0 ... STAGES-1] = { UINT32_MAX, 0 } };
+static uint16_t histogram[LATENCY_BUCKETS];
+
+
+static void range_add(uint8_t stage, uint32_t t)
+{
+    if (t < range[stage].min) range[stage].min = t;
+    if (t > range[stage].max) range[stage].max = t;
+}
+
+/* first change after last report starts measurement */
+void latency_scan(void)
+{
+    if (pending) return;
+    scan_time = latency_now();
+    pending = PENDING_SCAN;
+}
+
+void latency_action(void)
+{
+    if (pending != PENDING_SCAN) return;
+    action_time = latency_now();
+    pending |= PENDING_ACTION;
+}
+
+void latency_send(void)
+{
+    if (!pending) return;
+
+    uint32_t now = latency_now();
+    uint32_t total = now - scan_time;
+    if (pending & PENDING_ACTION) {
+        range_add(STAGE_SCAN_ACTION, action_time - scan_time);
+        range_add(STAGE_ACTION_SEND, now - action_time);
+    }
+    range_add(STAGE_SCAN_SEND, total);
+
+    uint8_t b = 0;
+    uint32_t limit = LATENCY_BUCKET0_US;
+    while (b < LATENCY_BUCKETS - 1 && total >= limit) {
+        limit <<= 1;
+        b++;
+    }
+    if (histogram[b] < UINT16_MAX) histogram[b]++;
+    if (count < UINT16_MAX) count++;
+    pending = 0;
+}
+
+void latency_clear(void)
+{
+    pending = 0;
+    count = 0;
+    for (uint8_t i = 0; i < STAGES; i++) {
+        range[i].min = UINT32_MAX;
+        range[i].max = 0;
+    }
+    for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+        histogram[i] = 0;
+    }
+}
+
+static void print_range(latency_range_t *r)
+{
+    if (r->min > r->max) {
+        print("-\n");
+        return;
+    }
+    xprintf("min %lu max %lu\n", (unsigned long)r->min, (unsigned long)r->max);
+}
+
+void latency_print(void)
+{
+    print("\n\t- Latency(us) -\n");
+    print("count: "); print_dec(count); print("\n");
+    if (!count) return;
+
+    print("scan-action: "); print_range(&range[STAGE_SCAN_ACTION]);
+    print("action-send: "); print_range(&range[STAGE_ACTION_SEND]);
+    print("scan-send: ");   print_range(&range[STAGE_SCAN_SEND]);
+    uint32_t limit = LATENCY_BUCKET0_US;
+    for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+        if (i < LATENCY_BUCKETS - 1) {
+            xprintf("<%lu: %u\n", (unsigned long)limit, histogram[i]);
+        } else {
+            xprintf(">=%lu: %u\n", (unsigned long)(limit >> 1), histogram[i]);
+        }
+        limit <<= 1;
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+
+/*
+ * Scan-to-report latency
+ *
+ * Time is stamped when key change is found by matrix scan, when the event
+ * reaches process_action() and when host driver sends the first report after
+ * it. Delays between the stages are kept as min/max and histogram of total.
+ */
+#ifdef LATENCY_ENABLE
+
+/* histogram bucket n counts latency below (LATENCY_BUCKET0_US << n) us */
+#ifndef LATENCY_BUCKET0_US
+#define LATENCY_BUCKET0_US  128
+#endif
+#define LATENCY_BUCKETS     10
+
+void latency_scan(void);
+void latency_action(void);
+void latency_send(void);
+void latency_clear(void);
+void latency_print(void);
+
+#else
+
+#define latency_scan()
+#define latency_action()
+#define latency_send()
+#define latency_clear()
+#define latency_print()
+
+#endif
+
+#endif
@@ -62,6 +62,9 @@ void matrix_print(void);
 /* power control */
 void matrix_power_up(void);
 void matrix_power_down(void);
+/* drive all rows active for pin change wakeup in suspend(SUSPEND_WAKEUP_PCMSKn) */
+void matrix_wakeup_arm(void);
+void matrix_wakeup_disarm(void);
 
 #ifdef __cplusplus
 }
@@ -18,8 +18,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef NODEBUG_H
 #define NODEBUG_H 1
 
+#ifndef NO_DEBUG
 #define NO_DEBUG
 #include "debug.h"
 #undef NO_DEBUG
+#else
+#include "debug.h"
+#endif
 
 #endif
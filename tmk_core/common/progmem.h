@@ -3,7 +3,7 @@
 
 #if defined(__AVR__)
 #   include <avr/pgmspace.h>
-#elif defined(__arm__)
+#elif defined(__arm__) || defined(PROTOCOL_SIM) || defined(KEYMAP_PACK)
 #   define PROGMEM
 #   define pgm_read_byte(p)     *(p)
 #   define pgm_read_word(p)     *(p)
@@ -0,0 +1,20 @@
+/* avr-libc eeprom API on emulated eeprom, see sim/eeprom_sim.h */
+#ifndef EEPROM_SIM_AVR_EEPROM_H
+#define EEPROM_SIM_AVR_EEPROM_H 1
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define E2END   1023
+
+int eeprom_is_ready(void);
+uint8_t eeprom_read_byte(const uint8_t *addr);
+uint16_t eeprom_read_word(const uint16_t *addr);
+void eeprom_read_block(void *dst, const void *src, size_t n);
+void eeprom_write_byte(uint8_t *addr, uint8_t value);
+void eeprom_write_word(uint16_t *addr, uint16_t value);
+void eeprom_update_byte(uint8_t *addr, uint8_t value);
+void eeprom_update_word(uint16_t *addr, uint16_t value);
+void eeprom_update_block(const void *src, void *dst, size_t n);
+
+#endif
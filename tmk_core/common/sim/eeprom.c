@@ -0,0 +1,116 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "timer_sim.h"
+#include "eeprom_sim.h"
+#include "avr/eeprom.h"
+
+/*
+ * Emulated eeprom. Write takes EEPROM_SIM_WRITE_US of virtual time and
+ * access during write waits for it as on AVR. Programmed times of each byte
+ * are counted to see wear.
+ */
+static uint8_t  eeprom[EEPROM_SIM_SIZE] = { [0 ... EEPROM_SIM_SIZE - 1] = 0xFF };
+static uint32_t wear[EEPROM_SIM_SIZE];
+static uint32_t writes = 0;
+static uint64_t ready_at = 0;
+static uint64_t wait_us = 0;
+
+
+static uint16_t addr_of(const void *addr)
+{
+    return (uintptr_t)addr % EEPROM_SIM_SIZE;
+}
+
+static void wait_ready(void)
+{
+    uint64_t now = timer_sim_read_us();
+    if (now < ready_at) {
+        wait_us += ready_at - now;
+        timer_sim_advance_us(ready_at - now);
+    }
+}
+
+void eeprom_sim_erase(void)
+{
+    for (uint16_t i = 0; i < EEPROM_SIM_SIZE; i++) {
+        eeprom[i] = 0xFF;
+        wear[i] = 0;
+    }
+    writes = 0;
+    wait_us = 0;
+}
+
+uint32_t eeprom_sim_writes(void) { return writes; }
+uint32_t eeprom_sim_wear(uint16_t addr) { return wear[addr % EEPROM_SIM_SIZE]; }
+uint64_t eeprom_sim_wait_us(void) { return wait_us; }
+
+uint32_t eeprom_sim_wear_max(void)
+{
+    uint32_t max = 0;
+    for (uint16_t i = 0; i < EEPROM_SIM_SIZE; i++) {
+        if (wear[i] > max) max = wear[i];
+    }
+    return max;
+}
+
+
+int eeprom_is_ready(void)
+{
+    return timer_sim_read_us() >= ready_at;
+}
+
+uint8_t eeprom_read_byte(const uint8_t *addr)
+{
+    wait_ready();
+    return eeprom[addr_of(addr)];
+}
+
+uint16_t eeprom_read_word(const uint16_t *addr)
+{
+    const uint8_t *p = (const uint8_t *)addr;
+    return eeprom_read_byte(p) | (eeprom_read_byte(p + 1) << 8);
+}
+
+void eeprom_read_block(void *dst, const void *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        ((uint8_t *)dst)[i] = eeprom_read_byte((const uint8_t *)src + i);
+    }
+}
+
+void eeprom_write_byte(uint8_t *addr, uint8_t value)
+{
+    wait_ready();
+    uint16_t a = addr_of(addr);
+    eeprom[a] = value;
+    wear[a]++;
+    writes++;
+    ready_at = timer_sim_read_us() + EEPROM_SIM_WRITE_US;
+}
+
+void eeprom_write_word(uint16_t *addr, uint16_t value)
+{
+    eeprom_write_byte((uint8_t *)addr, value);
+    eeprom_write_byte((uint8_t *)addr + 1, value >> 8);
+}
+
+void eeprom_update_byte(uint8_t *addr, uint8_t value)
+{
+    if (eeprom_read_byte(addr) != value) {
+        eeprom_write_byte(addr, value);
+    }
+}
+
+void eeprom_update_word(uint16_t *addr, uint16_t value)
+{
+    eeprom_update_byte((uint8_t *)addr, value);
+    eeprom_update_byte((uint8_t *)addr + 1, value >> 8);
+}
+
+void eeprom_update_block(const void *src, void *dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        eeprom_update_byte((uint8_t *)dst + i, ((const uint8_t *)src)[i]);
+    }
+}
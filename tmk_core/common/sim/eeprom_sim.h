@@ -0,0 +1,28 @@
+#ifndef EEPROM_SIM_H
+#define EEPROM_SIM_H 1
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EEPROM_SIM_SIZE     1024
+/* byte write time of AVR eeprom in virtual clock(us) */
+#define EEPROM_SIM_WRITE_US 3400
+
+/* erase to 0xFF and clear counters */
+void eeprom_sim_erase(void);
+/* bytes programmed */
+uint32_t eeprom_sim_writes(void);
+/* times the byte at addr was programmed */
+uint32_t eeprom_sim_wear(uint16_t addr);
+uint32_t eeprom_sim_wear_max(void);
+/* virtual time callers waited for eeprom to be ready(us) */
+uint64_t eeprom_sim_wait_us(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
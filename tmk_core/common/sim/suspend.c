@@ -0,0 +1,13 @@
+#include <stdbool.h>
+#include "timer_sim.h"
+
+
+/* sleep until next 1ms timer tick */
+void suspend_idle(uint8_t time)
+{
+    timer_sim_advance_us(1000 - timer_sim_read_us() % 1000);
+}
+
+void suspend_power_down(void) {}
+bool suspend_wakeup_condition(void) { return true; }
+void suspend_wakeup_init(void) {}
@@ -0,0 +1,52 @@
+#include <stdint.h>
+#include "timer.h"
+
+/* Virtual clock of simulation
+ * Nothing advances it but simulator and wait_ms()/wait_us(), so results don't
+ * depend on speed of workstation.
+ */
+static uint64_t timer_us = 0;
+
+/* Mill second tick count */
+volatile uint32_t timer_count = 0;
+
+void timer_init(void)
+{
+}
+
+void timer_clear(void)
+{
+    timer_count = 0;
+}
+
+uint16_t timer_read(void)
+{
+    return (uint16_t)(timer_count & 0xFFFF);
+}
+
+uint32_t timer_read32(void)
+{
+    return timer_count;
+}
+
+uint16_t timer_elapsed(uint16_t last)
+{
+    return TIMER_DIFF_16(timer_read(), last);
+}
+
+uint32_t timer_elapsed32(uint32_t last)
+{
+    return TIMER_DIFF_32(timer_read32(), last);
+}
+
+uint64_t timer_sim_read_us(void)
+{
+    return timer_us;
+}
+
+void timer_sim_advance_us(uint32_t us)
+{
+    uint32_t ms = (timer_us % 1000 + us) / 1000;
+    timer_us += us;
+    timer_count += ms;
+}
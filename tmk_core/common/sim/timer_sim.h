@@ -0,0 +1,18 @@
+#ifndef TIMER_SIM_H
+#define TIMER_SIM_H 1
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* virtual clock in micro seconds */
+uint64_t timer_sim_read_us(void);
+void timer_sim_advance_us(uint32_t us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
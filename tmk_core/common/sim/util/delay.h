@@ -0,0 +1,10 @@
+/* avr-libc busy wait on virtual clock */
+#ifndef DELAY_SIM_UTIL_DELAY_H
+#define DELAY_SIM_UTIL_DELAY_H 1
+
+#include "timer_sim.h"
+
+#define _delay_ms(ms)   timer_sim_advance_us((uint32_t)(ms) * 1000)
+#define _delay_us(us)   timer_sim_advance_us(us)
+
+#endif
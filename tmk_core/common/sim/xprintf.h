@@ -0,0 +1,10 @@
+#ifndef XPRINTF_H
+#define XPRINTF_H
+
+#include <stdio.h>
+
+/* console output of simulation goes to stderr to keep report log on stdout clean */
+#define xprintf(...)    fprintf(stderr, __VA_ARGS__)
+#define xputs(s)        fputs(s, stderr)
+
+#endif
@@ -78,6 +78,29 @@ uint8_t biton32(uint32_t bits)
     return n;
 }
 
+// least significant on-bit - return lowest location of on-bit(count trailing zeros)
+// NOTE: return 0 when bit0 is on or all bits are off
+static const uint8_t ctz_nibble[16] = { 0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0 };
+
+uint8_t bitctz(uint8_t bits)
+{
+    if (bits & 0x0F) return ctz_nibble[bits & 0x0F];
+    if (bits & 0xF0) return ctz_nibble[bits >> 4] + 4;
+    return 0;
+}
+
+uint8_t bitctz16(uint16_t bits)
+{
+    if (bits & 0x00FF) return bitctz(bits & 0xFF);
+    return bitctz(bits >> 8) + 8;
+}
+
+uint8_t bitctz32(uint32_t bits)
+{
+    if (bits & 0x0000FFFF) return bitctz16(bits & 0xFFFF);
+    return bitctz16(bits >> 16) + 16;
+}
+
 
 
 uint8_t bitrev(uint8_t bits)
@@ -9,6 +9,10 @@ extern "C" {
 #   include <util/delay.h>
 #   define wait_ms(ms)  _delay_ms(ms)
 #   define wait_us(us)  _delay_us(us)
+#elif defined(PROTOCOL_SIM)
+#   include "sim/timer_sim.h"
+#   define wait_ms(ms)  timer_sim_advance_us((uint32_t)(ms) * 1000)
+#   define wait_us(us)  timer_sim_advance_us(us)
 #elif defined(__arm__)
 #   include "wait_api.h"
 #endif
@@ -50,5 +50,21 @@ ifdef ADB_MOUSE_ENABLE
 	 OPT_DEFS += -DADB_MOUSE_ENABLE -DMOUSE_ENABLE
 endif
 
+ifdef ADB_USE_INT
+    SRC += protocol/adb_interrupt.c
+    OPT_DEFS += -DADB_USE_INT
+endif
+
+ifdef NEXT_USE_INT
+    ifdef SLEEP_LED_ENABLE
+        $(error NEXT_USE_INT and SLEEP_LED_ENABLE both use Timer1)
+    endif
+    ifdef BACKLIGHT_PWM_ENABLE
+        $(error NEXT_USE_INT and BACKLIGHT_PWM_ENABLE both use Timer1)
+    endif
+    SRC += protocol/next_kbd_interrupt.c
+    OPT_DEFS += -DNEXT_USE_INT
+endif
+
 # Search Path
 VPATH += $(TMK_DIR)/protocol
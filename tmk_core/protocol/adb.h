@@ -51,6 +51,11 @@ POSSIBILITY OF SUCH DAMAGE.
 #define ADB_POWER       0x7F
 #define ADB_CAPS        0x39
 
+/* ADB_USE_INT: ms between polls of a device in background */
+#ifndef ADB_POLL_INTERVAL
+#define ADB_POLL_INTERVAL   12
+#endif
+
 
 // ADB host
 void     adb_host_init(void);
@@ -59,6 +64,7 @@ uint16_t adb_host_kbd_recv(void);
 uint16_t adb_host_mouse_recv(void);
 void     adb_host_listen(uint8_t cmd, uint8_t data_h, uint8_t data_l);
 void     adb_host_kbd_led(uint8_t led);
+void     adb_host_enumerate(void);     // ADB_USE_INT only
 void     adb_mouse_task(void);
 void     adb_mouse_init(void);
 
@@ -0,0 +1,562 @@
+/*
+ * ADB protocol Pin interrupt version
+ *
+ * Transactions run in background on Timer3 compare and Data pin interrupts,
+ * see adb.c for the protocol. Interrupts are disabled only while a bit cell
+ * is placed on the line, never longer than its low part.
+ *
+ * Timer3 runs at F_CPU/8 for timestamps and scheduling:
+ *  - compare ISR places attention, each bit cell of command and data and
+ *    starts next transaction at fixed slots
+ *  - pin ISR timestamps edges of data from device and decodes a bit cell
+ *    at falling edge of next one, bit is 1 when its low part is shorter
+ *    than half of the cell
+ *  - compare ISR also times out Tlt and end of data
+ *
+ * A transaction starts at each slot of ADB_POLL_INTERVAL/2 ms. Listen
+ * commands take the next slot, otherwise a device is polled with Talk
+ * register 0, see "Devices on bus" below. Register 0 data received from
+ * keyboards and mice is queued for adb_host_kbd_recv() and
+ * adb_host_mouse_recv().
+ */
+#include <stdbool.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+#include "adb.h"
+
+
+#if !(defined(ADB_INT_INIT) && \
+      defined(ADB_INT_ON)   && \
+      defined(ADB_INT_OFF)  && \
+      defined(ADB_INT_VECT))
+#   error "ADB pin interrupt setting is required in config.h"
+#endif
+
+#define data_lo() (ADB_DDR |=  (1<<ADB_DATA_BIT))
+#define data_hi() (ADB_DDR &= ~(1<<ADB_DATA_BIT))
+#define data_in() (ADB_PIN &   (1<<ADB_DATA_BIT))
+
+/* Timer3 ticks of F_CPU/8 */
+#define US(us)  ((uint16_t)((us) * (F_CPU / 8 / 1000000)))
+
+#define SLOT    US(ADB_POLL_INTERVAL * 1000UL / 2)
+
+enum {
+    ADDR_KEYB  = 0x20,
+    ADDR_MOUSE = 0x30
+};
+
+#define CMD_TALK        0x0C
+#define CMD_LISTEN      0x08
+
+
+/* Queue of register 0 data received */
+#ifndef ADB_QUEUE_SIZE
+#define ADB_QUEUE_SIZE  8
+#endif
+
+typedef struct {
+    uint16_t data[ADB_QUEUE_SIZE];
+    volatile uint8_t head;
+    volatile uint8_t tail;
+} adb_queue_t;
+
+static adb_queue_t kbd_queue;
+#ifdef ADB_MOUSE_ENABLE
+static adb_queue_t mouse_queue;
+#endif
+
+static void queue_put(adb_queue_t *q, uint16_t data)
+{
+    uint8_t next = (q->head + 1) % ADB_QUEUE_SIZE;
+    if (next == q->tail) return;    // full, drop
+    q->data[q->head] = data;
+    q->head = next;
+}
+
+static uint16_t queue_get(adb_queue_t *q)
+{
+    if (q->head == q->tail) return 0;
+    uint16_t data = q->data[q->tail];
+    q->tail = (q->tail + 1) % ADB_QUEUE_SIZE;
+    return data;
+}
+
+
+/* Queue of Listen commands */
+#define LISTEN_QUEUE_SIZE   4
+static uint8_t listen_queue[LISTEN_QUEUE_SIZE][3];
+static volatile uint8_t listen_head = 0;
+static volatile uint8_t listen_tail = 0;
+
+
+/* Transaction in progress */
+enum {
+    IDLE,       // waiting for next slot
+    ATTENTION,  // line low for attention, cells follow
+    CELL,       // placing bit cells
+    TLT,        // stop to start before Listen data
+    RECV,       // receiving data of Talk
+};
+static volatile uint8_t state = IDLE;
+static uint16_t slot_time;
+static uint16_t cell_time;
+
+static uint8_t cmd;
+static uint8_t tx[3];
+static uint8_t tx_len;      // bytes to send in this phase
+static uint8_t tx_cell;     // next cell: 0 start bit, 1..8*tx_len data, then stop bit
+static uint8_t tx_pos;      // byte of tx at start of this phase
+
+static uint8_t rx[8];
+static uint8_t rx_falls;
+static uint16_t rx_fall;
+static uint16_t rx_rise;
+static bool rx_srq;
+
+
+/* Devices on bus
+ *
+ * Keyboard(default address 2) and mouse(3) are polled at default address
+ * from start. adb_host_enumerate() finds all devices of these classes, like
+ * keypad or trackball which have same default address: device answering
+ * Talk register 3 at default address is moved to free address from 15 down
+ * by Listen register 3 with handler 0xFE(move unless collided), until none
+ * answers. Then the first one moved is moved back to default address, so
+ * that commands to default address still reach it. Class with no device
+ * found is still polled at default address for one connected later.
+ *
+ * Idle devices are not polled. Device which sent data last is polled every
+ * other slot and bus is left idle in slots between. Service Request at stop
+ * bit of Talk tells that another device has data, then others are polled in
+ * turn at every slot until one sends and becomes the device polled. A device
+ * is never polled in two slots in a row. After ADB_IDLE_POLL polls without
+ * SRQ one of others is polled in turn, in case it doesn't assert SRQ.
+ */
+#ifndef ADB_IDLE_POLL
+#define ADB_IDLE_POLL   8
+#endif
+#ifndef ADB_MAX_DEVICES
+#define ADB_MAX_DEVICES 6
+#endif
+#define NONE    0xFF
+
+typedef struct {
+    uint8_t addr;
+    uint8_t kind;       // default address
+    uint8_t handler;
+} adb_device_t;
+
+static adb_device_t devices[ADB_MAX_DEVICES];
+static uint8_t device_count = 0;
+static uint8_t current = 0;     // device sent data last
+static uint8_t last = NONE;     // device polled in last slot
+static uint8_t turn = 0;        // device polled last in turn
+static bool srq = false;        // Service Request at last poll
+static uint8_t idle = 0;        // polls without SRQ
+
+enum {
+    ENUM_NONE,
+    ENUM_TALK,  // Talk R3 at default address
+    ENUM_MOVE,  // Listen R3 to move it to free address
+    ENUM_CHECK, // Talk R3 at free address
+    ENUM_BACK,  // Listen R3 to move first one back
+};
+static volatile uint8_t enum_state = ENUM_NONE;
+static uint8_t enum_kind;
+static uint8_t enum_free;
+static uint8_t enum_first;
+static uint8_t enum_handler;
+
+/* job of this slot */
+enum {
+    JOB_LISTEN,
+    JOB_ENUM,
+    JOB_POLL,
+};
+static uint8_t job;
+static uint8_t job_device;
+
+static void add_device(uint8_t addr, uint8_t kind, uint8_t handler)
+{
+    if (device_count >= ADB_MAX_DEVICES) return;
+    devices[device_count].addr = addr;
+    devices[device_count].kind = kind;
+    devices[device_count].handler = handler;
+    device_count++;
+}
+
+static uint8_t poll_select(void)
+{
+    if (srq || (current == last && ++idle >= ADB_IDLE_POLL)) {
+        idle = 0;
+        for (uint8_t n = 0; n < device_count; n++) {
+            turn = (turn + 1) % device_count;
+            if (turn != last) return turn;
+        }
+    }
+    if (current != last && current < device_count) {
+        return current;
+    }
+    return NONE;
+}
+
+/* slots left for this kind, one is kept for mouse at default address */
+static uint8_t enum_room(void)
+{
+    uint8_t room = ADB_MAX_DEVICES - device_count;
+#ifdef ADB_MOUSE_ENABLE
+    if (enum_kind == (ADDR_KEYB>>4) && room) room--;
+#endif
+    return room;
+}
+
+static void enum_next_kind(void)
+{
+    enum_first = NONE;
+    // polled at default address even if not found, as in adb_host_init()
+    bool found = false;
+    for (uint8_t i = 0; i < device_count; i++) {
+        if (devices[i].kind == enum_kind) found = true;
+    }
+    if (!found) add_device(enum_kind, enum_kind, 0);
+#ifdef ADB_MOUSE_ENABLE
+    if (enum_kind == (ADDR_KEYB>>4)) {
+        enum_kind = (ADDR_MOUSE>>4);
+        enum_state = ENUM_TALK;
+        return;
+    }
+#endif
+    enum_state = ENUM_NONE;
+    current = 0;
+    last = NONE;
+}
+
+static void enum_done(bool got)
+{
+    switch (enum_state) {
+    case ENUM_TALK:
+        if (!got) {
+            enum_state = (enum_first != NONE ? ENUM_BACK : ENUM_NONE);
+            if (enum_state == ENUM_NONE) enum_next_kind();
+        } else if (enum_room() <= 1 || enum_free <= 7) {
+            // no room to move, left at default address
+            add_device(enum_kind, enum_kind, rx[1]);
+            enum_next_kind();
+        } else {
+            enum_handler = rx[1];
+            enum_state = ENUM_MOVE;
+        }
+        break;
+    case ENUM_MOVE:
+        enum_state = ENUM_CHECK;
+        break;
+    case ENUM_CHECK:
+        if (got) {
+            if (enum_first == NONE) enum_first = device_count;
+            add_device(enum_free--, enum_kind, rx[1]);
+            enum_state = ENUM_TALK;
+        } else {
+            // device can't move
+            add_device(enum_kind, enum_kind, enum_handler);
+            enum_first = NONE;
+            enum_next_kind();
+        }
+        break;
+    case ENUM_BACK:
+        devices[enum_first].addr = enum_kind;
+        enum_next_kind();
+        break;
+    }
+}
+
+static void enum_command(void)
+{
+    switch (enum_state) {
+    case ENUM_TALK:
+        cmd = (enum_kind<<4) | CMD_TALK | 3;
+        break;
+    case ENUM_MOVE:
+        cmd = (enum_kind<<4) | CMD_LISTEN | 3;
+        tx[1] = 0x20 | enum_free;       // SRQ enable, address
+        tx[2] = 0xFE;
+        break;
+    case ENUM_CHECK:
+        cmd = (enum_free<<4) | CMD_TALK | 3;
+        break;
+    case ENUM_BACK:
+        cmd = (devices[enum_first].addr<<4) | CMD_LISTEN | 3;
+        tx[1] = 0x20 | enum_kind;
+        tx[2] = 0xFE;
+        break;
+    }
+}
+
+
+static inline void compare_at(uint16_t t)
+{
+    // ISR latency may have passed the time, match would wait for overflow
+    if ((int16_t)(t - TCNT3) < (int16_t)US(4)) {
+        t = TCNT3 + US(4);
+    }
+    OCR3A = t;
+    TIFR3 = (1<<OCF3A);
+}
+
+static void next_slot(void)
+{
+    state = IDLE;
+    slot_time += SLOT;
+    compare_at(slot_time);
+}
+
+static void start_transaction(void)
+{
+    job_device = NONE;
+    if (listen_head != listen_tail) {
+        job = JOB_LISTEN;
+        cmd   = listen_queue[listen_tail][0];
+        tx[1] = listen_queue[listen_tail][1];
+        tx[2] = listen_queue[listen_tail][2];
+        listen_tail = (listen_tail + 1) % LISTEN_QUEUE_SIZE;
+    } else if (enum_state != ENUM_NONE) {
+        job = JOB_ENUM;
+        enum_command();
+    } else {
+        job = JOB_POLL;
+        job_device = poll_select();
+        if (job_device == NONE) {
+            last = NONE;
+            next_slot();
+            return;
+        }
+        cmd = (devices[job_device].addr<<4) | CMD_TALK;
+    }
+    last = job_device;
+    tx[0] = cmd;
+    tx_pos = 0;
+    tx_len = 1;
+    tx_cell = 0;
+
+    // attention: 560-1040us, start bit follows
+    data_lo();
+    state = ATTENTION;
+    cell_time = TCNT3 + US(800 - 35);
+    compare_at(cell_time);
+}
+
+static void transaction_done(bool got)
+{
+    if (job == JOB_ENUM) {
+        enum_done(got);
+    } else if (job == JOB_POLL) {
+        srq = rx_srq;
+        if (got) {
+            uint16_t data = (rx[0]<<8) | rx[1];
+            current = job_device;
+            if (devices[job_device].kind == (ADDR_KEYB>>4)) {
+                queue_put(&kbd_queue, data);
+            }
+#ifdef ADB_MOUSE_ENABLE
+            else if (devices[job_device].kind == (ADDR_MOUSE>>4)) {
+                queue_put(&mouse_queue, data);
+            }
+#endif
+        }
+    }
+    next_slot();
+}
+
+static void recv_done(void)
+{
+    ADB_INT_OFF();
+    // start bit and stop bit are not data
+    transaction_done(rx_falls >= 2 + 16);
+}
+
+/* Places a bit cell and schedules next step */
+static void place_cell(void)
+{
+    uint8_t bits = tx_len * 8;
+    bool bit1;
+    if (tx_cell == 0) {
+        bit1 = true;                                // start bit
+    } else if (tx_cell <= bits) {
+        uint8_t i = tx_cell - 1;
+        bit1 = tx[tx_pos + i/8] & (0x80>>(i%8));
+    } else {
+        bit1 = false;                               // stop bit
+    }
+
+    // low part in ISR, high part in background
+    data_lo();
+    if (bit1) {
+        _delay_us(35);
+    } else {
+        _delay_us(65);
+    }
+    data_hi();
+
+    if (tx_cell++ <= bits) {
+        cell_time += US(100);
+        compare_at(cell_time);
+        return;
+    }
+
+    // stop bit placed
+    if ((cmd & 0x0C) == CMD_LISTEN && tx_pos == 0) {
+        // Tlt(140-260us) then data
+        tx_pos = 1;
+        tx_len = 2;
+        tx_cell = 0;
+        state = TLT;
+        cell_time += US(100 + 200);
+        compare_at(cell_time);
+    } else if ((cmd & 0x0C) == CMD_TALK) {
+        // Service Request of device may hold line low at stop bit,
+        // device starts data after line is high for Tlt(140-260us)
+        _delay_us(3);
+        rx_srq = !data_in();
+        rx_falls = 0;
+        rx_rise = TCNT3;
+        for (uint8_t i = 0; i < sizeof(rx); i++) rx[i] = 0;
+        state = RECV;
+        ADB_INT_ON();
+        compare_at(TCNT3 + US(35 + 300 + 300));
+    } else {
+        transaction_done(false);
+    }
+}
+
+/* Timer3 compare: transaction sequencing */
+ISR(TIMER3_COMPA_vect)
+{
+    switch (state) {
+    case IDLE:
+        slot_time = OCR3A;
+        start_transaction();
+        break;
+    case ATTENTION:
+        // line is still low, continue to low part of start bit
+    case TLT:
+        state = CELL;
+    case CELL:
+        place_cell();
+        break;
+    case RECV:
+        // no edge: no data, or end of data after stop bit
+        recv_done();
+        break;
+    }
+}
+
+/* Data pin change: bit cells from device */
+ISR(ADB_INT_VECT)
+{
+    uint16_t t = TCNT3;
+
+    if (data_in()) {
+        rx_rise = t;
+    } else if (!rx_falls && (uint16_t)(t - rx_rise) < US(100)) {
+        // Service Request asserted late at stop bit, not start bit
+        rx_srq = true;
+    } else {
+        if (rx_falls > 1) {
+            // previous cell is data bit, start bit is not stored
+            uint8_t i = rx_falls - 2;
+            if (i < sizeof(rx) * 8 && (uint16_t)(rx_rise - rx_fall) * 2 < (uint16_t)(t - rx_fall)) {
+                rx[i/8] |= 0x80>>(i%8);
+            }
+        }
+        rx_fall = t;
+        rx_falls++;
+    }
+    if (rx_falls) {
+        // bit cell is 130us at most, line stays high after stop bit
+        compare_at(t + US(200));
+    } else {
+        // end of Service Request, start bit within Tlt
+        compare_at(t + US(300));
+    }
+}
+
+
+void adb_host_init(void)
+{
+    ADB_PORT &= ~(1<<ADB_DATA_BIT);
+    data_hi();
+#ifdef ADB_PSW_BIT
+    ADB_PORT |=  (1<<ADB_PSW_BIT);
+    ADB_DDR  &= ~(1<<ADB_PSW_BIT);
+#endif
+
+    ADB_INT_INIT();
+    ADB_INT_OFF();
+
+    // Timer3: normal mode, F_CPU/8
+    TCCR3A = 0;
+    TCCR3B = (1<<CS31);
+    state = IDLE;
+    device_count = 0;
+    add_device(ADDR_KEYB>>4, ADDR_KEYB>>4, 0);
+#ifdef ADB_MOUSE_ENABLE
+    add_device(ADDR_MOUSE>>4, ADDR_MOUSE>>4, 0);
+#endif
+    slot_time = TCNT3;
+    compare_at(slot_time + SLOT);
+    TIMSK3 |= (1<<OCIE3A);
+}
+
+#ifdef ADB_PSW_BIT
+bool adb_host_psw(void)
+{
+    return ADB_PIN&(1<<ADB_PSW_BIT);
+}
+#endif
+
+uint16_t adb_host_kbd_recv(void)
+{
+    return queue_get(&kbd_queue);
+}
+
+#ifdef ADB_MOUSE_ENABLE
+void adb_mouse_init(void) {
+    return;
+}
+
+uint16_t adb_host_mouse_recv(void)
+{
+    return queue_get(&mouse_queue);
+}
+#endif
+
+void adb_host_listen(uint8_t cmd, uint8_t data_h, uint8_t data_l)
+{
+    uint8_t next = (listen_head + 1) % LISTEN_QUEUE_SIZE;
+    if (next == listen_tail) return;    // full, drop
+    listen_queue[listen_head][0] = cmd;
+    listen_queue[listen_head][1] = data_h;
+    listen_queue[listen_head][2] = data_l;
+    listen_head = next;
+}
+
+// send state of LEDs
+void adb_host_kbd_led(uint8_t led)
+{
+    // Addr:Keyboard(0010), Cmd:Listen(10), Register2(10)
+    adb_host_listen(0x2A,0,led&0x07);
+}
+
+void adb_host_enumerate(void)
+{
+    // devices are found again, polling stops until done
+    uint8_t sreg = SREG;
+    cli();
+    device_count = 0;
+    enum_kind = (ADDR_KEYB>>4);
+    enum_free = 15;
+    enum_first = NONE;
+    enum_state = ENUM_TALK;
+    SREG = sreg;
+}
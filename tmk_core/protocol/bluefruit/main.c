@@ -44,6 +44,7 @@ int main(void)
 {   
 
     CPU_PRESCALE(0);
+    keyboard_setup();
 
     DDRD  = _BV(PD5);
     DDRB  = _BV(PB0);
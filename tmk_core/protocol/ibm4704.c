@@ -8,6 +8,10 @@ Copyright 2010,2011,2012,2013 Jun WAKO <wakojun@gmail.com>
 #include "ibm4704.h"
 
 
+/* Ring buffer to store scan codes from keyboard */
+RBUF_DEFINE(rbuf, 32);
+
+
 #define WAIT(stat, us, err) do { \
     if (!wait_##stat(us)) { \
         ibm4704_error = err; \
@@ -99,16 +103,16 @@ ERROR:
 /* wait forever to receive data */
 uint8_t ibm4704_recv_response(void)
 {
-    while (!rbuf_has_data()) {
+    while (!rbuf_has_data(&rbuf)) {
         _delay_ms(1);
     }
-    return rbuf_dequeue();
+    return rbuf_dequeue(&rbuf);
 }
 
 uint8_t ibm4704_recv(void)
 {
-    if (rbuf_has_data()) {
-        return rbuf_dequeue();
+    if (rbuf_has_data(&rbuf)) {
+        return rbuf_dequeue(&rbuf);
     } else {
         return -1;
     }
@@ -167,7 +171,7 @@ ISR(IBM4704_INT_VECT)
         case STOP:
             // Data:Low
             WAIT(data_lo, 100, state);
-            rbuf_enqueue(data);
+            rbuf_enqueue(&rbuf, data);
             ibm4704_error = IBM4704_ERR_NONE;
             goto DONE;
             break;
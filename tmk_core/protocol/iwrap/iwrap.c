@@ -33,9 +33,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "suart.h"
 #include "uart.h"
 #include "report.h"
+#include "host.h"
 #include "host_driver.h"
 #include "iwrap.h"
 #include "print.h"
+#include "ring_buffer.h"
 
 
 /* iWRAP MUX mode utils. 3.10 HID raw mode(iWRAP_HID_Application_Note.pdf) */
@@ -56,44 +58,24 @@ static uint8_t connected = 0;
 static char buf[MUX_BUF_SIZE];
 static uint8_t snd_pos = 0;
 
+/* receive buffer
+ * Responses are parsed in place as string from rcv_data, so it is rewound to
+ * start of storage before each command.
+ */
 #define MUX_RCV_BUF_SIZE 256
-static char rcv_buf[MUX_RCV_BUF_SIZE];
-static uint8_t rcv_head = 0;
-static uint8_t rcv_tail = 0;
-
-
-/* receive buffer */
-static void rcv_enq(char c)
-{
-    uint8_t next = (rcv_head + 1) % MUX_RCV_BUF_SIZE;
-    if (next != rcv_tail) {
-        rcv_buf[rcv_head] = c;
-        rcv_head = next;
-    }
-}
+RBUF_DEFINE(rcv, MUX_RCV_BUF_SIZE);
 
 static char rcv_deq(void)
 {
-    char c = 0;
-    if (rcv_head != rcv_tail) {
-        c = rcv_buf[rcv_tail++];
-        rcv_tail %= MUX_RCV_BUF_SIZE;
-    }
-    return c;
-}
-
-/*
-static char rcv_peek(void)
-{
-    if (rcv_head == rcv_tail)
-        return 0;
-    return rcv_buf[rcv_tail];
+    return (char)rbuf_dequeue(&rcv);
 }
-*/
 
 static void rcv_clear(void)
 {
-    rcv_tail = rcv_head = 0;
+    uint8_t sreg = SREG;
+    cli();
+    rcv.head = rcv.tail = 0;
+    SREG = sreg;
 }
 
 /* iWRAP response */
@@ -127,7 +109,7 @@ ISR(PCINT1_vect, ISR_BLOCK) // recv() runs away in case of ISR_NOBLOCK
         default:
             if (mux_state--) {
                 uart_putchar(c);
-                rcv_enq(c);
+                rbuf_enqueue(&rcv, c);
             }
     }
 }
@@ -189,7 +171,7 @@ void iwrap_call(void)
     iwrap_mux_send("SET BT PAIR");
     _delay_ms(500);
 
-    p = rcv_buf + rcv_tail;
+    p = (char *)rcv_data + rcv.tail;
     while (!strncmp(p, "SET BT PAIR", 11)) {
         p += 7;
         strncpy(p, "CALL", 4);
@@ -231,7 +213,7 @@ void iwrap_kill(void)
     _delay_ms(500);
 
     while ((c = rcv_deq()) && c != '\n') ;
-    if (strncmp(rcv_buf + rcv_tail, "LIST ", 5)) {
+    if (strncmp((char *)rcv_data + rcv.tail, "LIST ", 5)) {
         print("no connection to kill.\n");
         return;
     }
@@ -239,7 +221,7 @@ void iwrap_kill(void)
     for (uint8_t i = 10; i; i--)
         while ((c = rcv_deq()) && c != ' ') ;
 
-    char *p = rcv_buf + rcv_tail - 5;
+    char *p = (char *)rcv_data + rcv.tail - 5;
     strncpy(p, "KILL ", 5);
     strncpy(p + 22, "\n\0", 2);
     print_S(p);
@@ -254,7 +236,7 @@ void iwrap_unpair(void)
     iwrap_mux_send("SET BT PAIR");
     _delay_ms(500);
 
-    char *p = rcv_buf + rcv_tail;
+    char *p = (char *)rcv_data + rcv.tail;
     if (!strncmp(p, "SET BT PAIR", 11)) {
         strncpy(p+29, "\n\0", 2);
         print_S(p);
@@ -277,7 +259,7 @@ void iwrap_subrate(void)
 
 bool iwrap_failed(void)
 {
-    if (strncmp(rcv_buf, "SYNTAX ERROR", 12))
+    if (strncmp((char *)rcv_data, "SYNTAX ERROR", 12))
         return true;
     else
         return false;
@@ -293,7 +275,7 @@ uint8_t iwrap_check_connection(void)
     iwrap_mux_send("LIST");
     _delay_ms(100);
 
-    if (strncmp(rcv_buf, "LIST ", 5) || !strncmp(rcv_buf, "LIST 0", 6))
+    if (strncmp((char *)rcv_data, "LIST ", 5) || !strncmp((char *)rcv_data, "LIST 0", 6))
         connected = 0;
     else
         connected = 1;
@@ -329,7 +311,10 @@ static uint8_t keyboard_leds(void) {
 
 static void send_keyboard(report_keyboard_t *report)
 {
-    if (!iwrap_connected() && !iwrap_check_connection()) return;
+    if (!iwrap_connected() && !iwrap_check_connection()) {
+        host_keyboard_unsent();
+        return;
+    }
     MUX_HEADER(0x01, 0x0c);
     // HID raw mode header
     xmit(0x9f);
@@ -350,7 +335,10 @@ static void send_keyboard(report_keyboard_t *report)
 static void send_mouse(report_mouse_t *report)
 {
 #if defined(MOUSEKEY_ENABLE) || defined(PS2_MOUSE_ENABLE)
-    if (!iwrap_connected() && !iwrap_check_connection()) return;
+    if (!iwrap_connected() && !iwrap_check_connection()) {
+        host_mouse_unsent();
+        return;
+    }
     MUX_HEADER(0x01, 0x09);
     // HID raw mode header
     xmit(0x9f);
@@ -363,6 +351,8 @@ static void send_mouse(report_mouse_t *report)
     xmit(report->v);
     xmit(report->h);
     MUX_FOOTER(0x01);
+#else
+    host_mouse_unsent();
 #endif
 }
 
@@ -135,6 +135,7 @@ int main(void)
     //pullup_pins();
     //set_prr();
 
+    keyboard_setup();
 #ifdef PROTOCOL_VUSB
     disable_vusb();
 #endif
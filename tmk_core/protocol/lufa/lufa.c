@@ -48,6 +48,7 @@
 #include "sleep_led.h"
 #endif
 #include "suspend.h"
+#include "latency.h"
 
 #include "descriptor.h"
 #include "lufa.h"
@@ -65,12 +66,14 @@ static void send_keyboard(report_keyboard_t *report);
 static void send_mouse(report_mouse_t *report);
 static void send_system(uint16_t data);
 static void send_consumer(uint16_t data);
+static bool keyboard_ready(void);
 host_driver_t lufa_driver = {
     keyboard_leds,
     send_keyboard,
     send_mouse,
     send_system,
-    send_consumer
+    send_consumer,
+    keyboard_ready
 };
 
 
@@ -136,6 +139,168 @@ static void Console_Task(void)
 #endif
 
 
+/*******************************************************************************
+ * Report queue
+ *
+ * Reports are queued per endpoint and written when the endpoint bank is free
+ * instead of busy waiting for host polling. Queue is drained right after
+ * enqueue and at every SOF(1ms). When queue is full the newest pending report
+ * is replaced, so that the last state is always delivered. System and consumer
+ * reports share an endpoint but have own queues, so that one never replaces
+ * the other.
+ ******************************************************************************/
+#ifndef REPORT_QUEUE_SIZE
+#define REPORT_QUEUE_SIZE   4
+#endif
+
+typedef struct {
+    uint8_t epnum;
+    uint8_t size;
+    uint8_t head;
+    uint8_t count;
+    uint8_t *buf;
+} report_queue_t;
+
+#define REPORT_QUEUE(name, ep, report_size) \
+    static uint8_t name##_buf[REPORT_QUEUE_SIZE][report_size]; \
+    static report_queue_t name = { .epnum = ep, .size = report_size, .buf = &name##_buf[0][0] }
+
+REPORT_QUEUE(keyboard_queue, KEYBOARD_IN_EPNUM, KEYBOARD_EPSIZE);
+#ifdef NKRO_ENABLE
+REPORT_QUEUE(nkro_queue, NKRO_IN_EPNUM, NKRO_EPSIZE);
+#endif
+#ifdef MOUSE_ENABLE
+REPORT_QUEUE(mouse_queue, MOUSE_IN_EPNUM, sizeof(report_mouse_t));
+#endif
+#ifdef EXTRAKEY_ENABLE
+REPORT_QUEUE(system_queue, EXTRAKEY_IN_EPNUM, sizeof(report_extra_t));
+REPORT_QUEUE(consumer_queue, EXTRAKEY_IN_EPNUM, sizeof(report_extra_t));
+#endif
+
+static uint8_t *report_queue_slot(report_queue_t *q, uint8_t i)
+{
+    return q->buf + ((q->head + i) % REPORT_QUEUE_SIZE) * q->size;
+}
+
+static uint8_t *report_queue_tail(report_queue_t *q)
+{
+    return q->count ? report_queue_slot(q, q->count - 1) : NULL;
+}
+
+/* NOTE: call with interrupt disabled */
+static void report_queue_push(report_queue_t *q, const void *report)
+{
+    uint8_t *tail = report_queue_tail(q);
+    if (tail) {
+        if (memcmp(tail, report, q->size) == 0) return;
+        if (q->count == REPORT_QUEUE_SIZE) {
+            /* supersede newest pending report */
+            memcpy(tail, report, q->size);
+            return;
+        }
+    }
+    memcpy(report_queue_slot(q, q->count), report, q->size);
+    q->count++;
+}
+
+/* write a report at head if endpoint bank is free */
+static void report_queue_flush(report_queue_t *q)
+{
+    if (!q->count) return;
+
+    Endpoint_SelectEndpoint(q->epnum);
+    if (!Endpoint_IsReadWriteAllowed()) return;
+
+    uint8_t *report = report_queue_slot(q, 0);
+    Endpoint_Write_Stream_LE(report, q->size, NULL);
+    Endpoint_ClearIN();
+
+    if (q == &keyboard_queue
+#ifdef NKRO_ENABLE
+            || q == &nkro_queue
+#endif
+    ) {
+        memcpy(&keyboard_report_sent, report, q->size);
+        latency_send();
+    }
+
+    q->head = (q->head + 1) % REPORT_QUEUE_SIZE;
+    q->count--;
+}
+
+/* NOTE: call with interrupt disabled */
+static void report_queue_task(void)
+{
+    if (USB_DeviceState != DEVICE_STATE_Configured)
+        return;
+
+    uint8_t ep = Endpoint_GetCurrentEndpoint();
+    report_queue_flush(&keyboard_queue);
+#ifdef NKRO_ENABLE
+    report_queue_flush(&nkro_queue);
+#endif
+#ifdef MOUSE_ENABLE
+    report_queue_flush(&mouse_queue);
+#endif
+#ifdef EXTRAKEY_ENABLE
+    report_queue_flush(&system_queue);
+    report_queue_flush(&consumer_queue);
+#endif
+    Endpoint_SelectEndpoint(ep);
+}
+
+static void report_queue_send(report_queue_t *q, const void *report)
+{
+    uint8_t sreg = SREG;
+    cli();
+    report_queue_push(q, report);
+    report_queue_task();
+    SREG = sreg;
+}
+
+/* discarded reports were never delivered, host must not suppress them */
+static void report_queue_clear(void)
+{
+    uint8_t sreg = SREG;
+    cli();
+    for (; keyboard_queue.count; keyboard_queue.count--) host_keyboard_unsent();
+#ifdef NKRO_ENABLE
+    for (; nkro_queue.count; nkro_queue.count--) host_keyboard_unsent();
+#endif
+#ifdef MOUSE_ENABLE
+    for (; mouse_queue.count; mouse_queue.count--) host_mouse_unsent();
+#endif
+#ifdef EXTRAKEY_ENABLE
+    system_queue.count = 0;
+    consumer_queue.count = 0;
+#endif
+    SREG = sreg;
+}
+
+#ifdef MOUSE_ENABLE
+/* add movement to pending report with same buttons
+ * NOTE: call with interrupt disabled */
+static bool mouse_queue_merge(report_mouse_t *report)
+{
+    report_mouse_t *tail = (report_mouse_t *)report_queue_tail(&mouse_queue);
+    if (!tail || tail->buttons != report->buttons) return false;
+
+    int16_t x = tail->x + report->x;
+    int16_t y = tail->y + report->y;
+    int16_t v = tail->v + report->v;
+    int16_t h = tail->h + report->h;
+    if (x < -127 || x > 127 || y < -127 || y > 127 ||
+        v < -127 || v > 127 || h < -127 || h > 127) return false;
+
+    tail->x = x;
+    tail->y = y;
+    tail->v = v;
+    tail->h = h;
+    return true;
+}
+#endif
+
+
 /*******************************************************************************
  * USB Events
  ******************************************************************************/
@@ -174,6 +339,7 @@ void EVENT_USB_Device_Disconnect(void)
 void EVENT_USB_Device_Reset(void)
 {
     print("[R]");
+    report_queue_clear();
 }
 
 void EVENT_USB_Device_Suspend()
@@ -201,10 +367,14 @@ static bool console_flush = false;
 #define CONSOLE_FLUSH_SET(b)   do { \
     uint8_t sreg = SREG; cli(); console_flush = b; SREG = sreg; \
 } while (0)
+#endif
 
 // called every 1ms
 void EVENT_USB_Device_StartOfFrame(void)
 {
+    report_queue_task();
+
+#ifdef CONSOLE_ENABLE
     static uint8_t count;
     if (++count % 50) return;
     count = 0;
@@ -212,8 +382,8 @@ void EVENT_USB_Device_StartOfFrame(void)
     if (!console_flush) return;
     Console_Task();
     console_flush = false;
-}
 #endif
+}
 
 /** Event handler for the USB_ConfigurationChanged event.
  * This is fired when the host sets the current configuration of the USB device after enumeration.
@@ -222,6 +392,9 @@ void EVENT_USB_Device_ConfigurationChanged(void)
 {
     bool ConfigSuccess = true;
 
+    /* reports queued for old configuration are stale */
+    report_queue_clear();
+
     /* Setup Keyboard HID Report Endpoints */
     ConfigSuccess &= ENDPOINT_CONFIG(KEYBOARD_IN_EPNUM, EP_TYPE_INTERRUPT, ENDPOINT_DIR_IN,
                                      KEYBOARD_EPSIZE, ENDPOINT_BANK_SINGLE);
@@ -346,11 +519,8 @@ void EVENT_USB_Device_ControlRequest(void)
                     Endpoint_ClearSETUP();
                     Endpoint_ClearStatusStage();
 
+                    /* keyboard_task() switches report format with keys held */
                     keyboard_protocol = ((USB_ControlRequest.wValue & 0xFF) != 0x00);
-#ifdef NKRO_ENABLE
-                    keyboard_nkro = !!keyboard_protocol;
-#endif
-                    clear_keyboard();
                 }
             }
 
@@ -389,71 +559,55 @@ static uint8_t keyboard_leds(void)
 
 static void send_keyboard(report_keyboard_t *report)
 {
-    uint8_t timeout = 255;
-
-    if (USB_DeviceState != DEVICE_STATE_Configured)
+    if (USB_DeviceState != DEVICE_STATE_Configured) {
+        host_keyboard_unsent();
         return;
+    }
 
-    /* Select the Keyboard Report Endpoint */
 #ifdef NKRO_ENABLE
     if (keyboard_nkro) {
         /* Report protocol - NKRO */
-        Endpoint_SelectEndpoint(NKRO_IN_EPNUM);
-
-        /* Check if write ready for a polling interval around 1ms */
-        while (timeout-- && !Endpoint_IsReadWriteAllowed()) _delay_us(4);
-        if (!Endpoint_IsReadWriteAllowed()) return;
-
-        /* Write Keyboard Report Data */
-        Endpoint_Write_Stream_LE(report, NKRO_EPSIZE, NULL);
+        report_queue_send(&nkro_queue, report);
     }
     else
 #endif
     {
         /* Boot protocol */
-        Endpoint_SelectEndpoint(KEYBOARD_IN_EPNUM);
-
-        /* Check if write ready for a polling interval around 10ms */
-        while (timeout-- && !Endpoint_IsReadWriteAllowed()) _delay_us(40);
-        if (!Endpoint_IsReadWriteAllowed()) return;
-
-        /* Write Keyboard Report Data */
-        Endpoint_Write_Stream_LE(report, KEYBOARD_EPSIZE, NULL);
+        report_queue_send(&keyboard_queue, report);
     }
+}
 
-    /* Finalize the stream transfer to send the last packet */
-    Endpoint_ClearIN();
-
-    keyboard_report_sent = *report;
+/* no keyboard report waits in queue */
+static bool keyboard_ready(void)
+{
+#ifdef NKRO_ENABLE
+    if (keyboard_nkro)
+        return !nkro_queue.count;
+#endif
+    return !keyboard_queue.count;
 }
 
 static void send_mouse(report_mouse_t *report)
 {
 #ifdef MOUSE_ENABLE
-    uint8_t timeout = 255;
-
-    if (USB_DeviceState != DEVICE_STATE_Configured)
+    if (USB_DeviceState != DEVICE_STATE_Configured) {
+        host_mouse_unsent();
         return;
+    }
 
-    /* Select the Mouse Report Endpoint */
-    Endpoint_SelectEndpoint(MOUSE_IN_EPNUM);
-
-    /* Check if write ready for a polling interval around 10ms */
-    while (timeout-- && !Endpoint_IsReadWriteAllowed()) _delay_us(40);
-    if (!Endpoint_IsReadWriteAllowed()) return;
-
-    /* Write Mouse Report Data */
-    Endpoint_Write_Stream_LE(report, sizeof(report_mouse_t), NULL);
-
-    /* Finalize the stream transfer to send the last packet */
-    Endpoint_ClearIN();
+    uint8_t sreg = SREG;
+    cli();
+    if (!mouse_queue_merge(report)) {
+        report_queue_push(&mouse_queue, report);
+    }
+    report_queue_task();
+    SREG = sreg;
 #endif
 }
 
 static void send_system(uint16_t data)
 {
-    uint8_t timeout = 255;
-
+#ifdef EXTRAKEY_ENABLE
     if (USB_DeviceState != DEVICE_STATE_Configured)
         return;
 
@@ -461,20 +615,13 @@ static void send_system(uint16_t data)
         .report_id = REPORT_ID_SYSTEM,
         .usage = data
     };
-    Endpoint_SelectEndpoint(EXTRAKEY_IN_EPNUM);
-
-    /* Check if write ready for a polling interval around 10ms */
-    while (timeout-- && !Endpoint_IsReadWriteAllowed()) _delay_us(40);
-    if (!Endpoint_IsReadWriteAllowed()) return;
-
-    Endpoint_Write_Stream_LE(&r, sizeof(report_extra_t), NULL);
-    Endpoint_ClearIN();
+    report_queue_send(&system_queue, &r);
+#endif
 }
 
 static void send_consumer(uint16_t data)
 {
-    uint8_t timeout = 255;
-
+#ifdef EXTRAKEY_ENABLE
     if (USB_DeviceState != DEVICE_STATE_Configured)
         return;
 
@@ -482,14 +629,8 @@ static void send_consumer(uint16_t data)
         .report_id = REPORT_ID_CONSUMER,
         .usage = data
     };
-    Endpoint_SelectEndpoint(EXTRAKEY_IN_EPNUM);
-
-    /* Check if write ready for a polling interval around 10ms */
-    while (timeout-- && !Endpoint_IsReadWriteAllowed()) _delay_us(40);
-    if (!Endpoint_IsReadWriteAllowed()) return;
-
-    Endpoint_Write_Stream_LE(&r, sizeof(report_extra_t), NULL);
-    Endpoint_ClearIN();
+    report_queue_send(&consumer_queue, &r);
+#endif
 }
 
 
@@ -582,7 +723,7 @@ static void setup_usb(void)
 
     USB_Init();
 
-    // for Console_Task
+    // for Console_Task and report queue
     USB_Device_EnableSOFEvents();
     print_set_sendchar(sendchar);
 }
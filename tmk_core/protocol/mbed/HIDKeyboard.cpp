@@ -13,8 +13,7 @@ HIDKeyboard::HIDKeyboard(uint16_t vendor_id, uint16_t product_id, uint16_t produ
 }
 
 bool HIDKeyboard::sendReport(report_keyboard_t report) {
-    USBDevice::write(EP1IN, report.raw, sizeof(report), MAX_PACKET_SIZE_EP1);
-    return true;
+    return USBDevice::write(EP1IN, report.raw, sizeof(report), MAX_PACKET_SIZE_EP1);
 }
 
 uint8_t HIDKeyboard::leds() {
@@ -28,10 +28,12 @@ static uint8_t keyboard_leds(void)
 }
 static void send_keyboard(report_keyboard_t *report)
 {
-    keyboard.sendReport(*report);
+    if (!keyboard.sendReport(*report)) host_keyboard_unsent();
 }
 static void send_mouse(report_mouse_t *report)
 {
+    // mouse is not supported
+    host_mouse_unsent();
 }
 static void send_system(uint16_t data)
 {
@@ -53,6 +53,11 @@ POSSIBILITY OF SUCH DAMAGE.
 #define NEXT_KBD_KMBUS_IDLE 0x300600
 #define NEXT_KBD_TIMING     50
 
+/* NEXT_USE_INT: ms between queries in background */
+#ifndef NEXT_KBD_POLL_INTERVAL
+#define NEXT_KBD_POLL_INTERVAL  10
+#endif
+
 extern uint8_t next_kbd_error;
 
 /* host role */
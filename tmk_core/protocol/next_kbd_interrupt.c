@@ -0,0 +1,277 @@
+/*
+ * NeXT non-ADB Keyboard Protocol Pin interrupt version
+ *
+ * Query and response run in background on Timer1 compare and pin interrupt
+ * of Keyboard Out line, see next_kbd.c for the protocol. Interrupts are not
+ * disabled other than in ISRs, which never wait for the line.
+ *
+ * Timer1 runs at F_CPU/64 for timestamps and scheduling:
+ *  - compare ISR drives Keyboard In line through steps of query, LED and
+ *    reset commands, each step is a level for some intervals
+ *  - pin ISR timestamps edges of response, bits since previous edge are
+ *    counted from time between them so that timing is resynced at every
+ *    edge instead of only at bit 10
+ *  - compare ISR also times out response and end of 22-bit frame
+ *
+ * Keyboard is queried every NEXT_KBD_POLL_INTERVAL ms, LED command set by
+ * next_kbd_set_leds() is sent before next query. Responses other than idle
+ * are queued for next_kbd_recv(), which returns 0 when nothing is queued.
+ * No response in NEXT_KBD_RESP_TIMEOUT ms resets keyboard.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "next_kbd.h"
+
+
+#if !(defined(NEXT_KBD_INT_INIT) && \
+      defined(NEXT_KBD_INT_ON)   && \
+      defined(NEXT_KBD_INT_OFF)  && \
+      defined(NEXT_KBD_INT_VECT))
+#   error "NeXT pin interrupt setting is required in config.h"
+#endif
+
+#ifndef NEXT_KBD_RESP_TIMEOUT
+#define NEXT_KBD_RESP_TIMEOUT   20
+#endif
+
+#ifndef NEXT_KBD_QUEUE_SIZE
+#define NEXT_KBD_QUEUE_SIZE     8
+#endif
+
+#define NEXT_KBD_READ (NEXT_KBD_IN_PIN&(1<<NEXT_KBD_IN_BIT))
+
+/* Timer1 ticks of F_CPU/64 */
+#define US(us)  ((uint16_t)((us) * (F_CPU / 1000000UL) / 64))
+#define CELL    US(NEXT_KBD_TIMING)
+#define CELL2   US(NEXT_KBD_TIMING * 2)     // two cells, CELL may be rounded off
+#define BITS    22
+
+#if NEXT_KBD_POLL_INTERVAL > 100 || NEXT_KBD_RESP_TIMEOUT > 100
+#   error "NEXT_KBD_POLL_INTERVAL and NEXT_KBD_RESP_TIMEOUT must be within 100ms"
+#endif
+
+
+/* 1 while keyboard doesn't respond */
+uint8_t next_kbd_error = 0;
+
+
+/* Queue of responses */
+static uint32_t queue[NEXT_KBD_QUEUE_SIZE];
+static volatile uint8_t queue_head = 0;
+static volatile uint8_t queue_tail = 0;
+
+static void queue_put(uint32_t data)
+{
+    uint8_t next = (queue_head + 1) % NEXT_KBD_QUEUE_SIZE;
+    if (next == queue_tail) return;    // full, drop
+    queue[queue_head] = data;
+    queue_head = next;
+}
+
+
+/* Steps of Keyboard In line: level and number of intervals, 0 ends */
+#define LO(n)   (n)
+#define HI(n)   (0x80 | (n))
+
+static const uint8_t init_steps[] = {
+    LO(5), HI(1), LO(3), HI(5),                 // query
+    LO(1), HI(4), LO(1), HI(6), LO(10), HI(8),  // reset
+    LO(5), HI(1), LO(3), HI(5),
+    LO(1), HI(4), LO(1), HI(6), LO(10), HI(8),
+    0
+};
+static const uint8_t query_steps[] = {
+    LO(5), HI(1), LO(3),
+    0
+};
+static const uint8_t reset_steps[] = {
+    LO(1), HI(4), LO(1), HI(6), LO(10), HI(8),
+    0
+};
+static uint8_t led_steps[] = {
+    LO(9), HI(3), LO(1), LO(1), LO(1), LO(7), HI(8),
+    0
+};
+
+/* LED command: bit1 left, bit0 right, bit7 pending */
+static volatile uint8_t led_command = 0;
+
+
+/* Transaction in progress */
+static volatile enum {
+    IDLE,
+    OUT,        // placing steps
+    WAIT,       // waiting for response
+    FRAME,      // receiving response
+} state = IDLE;
+
+static const uint8_t *steps;
+static uint16_t step_time;
+static uint16_t poll_time;
+static uint32_t rx_data;
+static uint8_t rx_bits;
+static uint16_t rx_edge;
+
+
+static inline void out_lo(void)
+{
+    NEXT_KBD_OUT_PORT &= ~(1<<NEXT_KBD_OUT_BIT);
+    NEXT_KBD_OUT_DDR  |=  (1<<NEXT_KBD_OUT_BIT);
+}
+
+static inline void out_hi(void)
+{
+    /* input with pull up */
+    NEXT_KBD_OUT_DDR  &= ~(1<<NEXT_KBD_OUT_BIT);
+    NEXT_KBD_OUT_PORT |=  (1<<NEXT_KBD_OUT_BIT);
+}
+
+static inline void compare_at(uint16_t t)
+{
+    // ISR latency may have passed the time, match would wait for overflow
+    if ((int16_t)(t - TCNT1) < (int16_t)US(8)) {
+        t = TCNT1 + US(8);
+    }
+    OCR1A = t;
+    TIFR1 = (1<<OCF1A);
+}
+
+static void start_steps(const uint8_t *s)
+{
+    steps = s;
+    step_time = TCNT1 + US(16);
+    state = OUT;
+    compare_at(step_time);
+}
+
+/* next command: LED if pending, otherwise query at next poll */
+static void next_command(void)
+{
+    uint8_t led = led_command;
+    if (led & 0x80) {
+        led_command = led & 0x03;
+        led_steps[3] = (led & 0x02) ? HI(1) : LO(1);
+        led_steps[4] = (led & 0x01) ? HI(1) : LO(1);
+        start_steps(led_steps);
+        return;
+    }
+    state = IDLE;
+    compare_at(poll_time);
+}
+
+static void frame_done(void)
+{
+    NEXT_KBD_INT_OFF();
+    if (rx_data != NEXT_KBD_KMBUS_IDLE) {
+        queue_put(rx_data);
+    }
+    next_command();
+}
+
+/* Timer1 compare: steps and timeouts */
+ISR(TIMER1_COMPA_vect)
+{
+    switch (state) {
+    case IDLE:
+        poll_time = TCNT1 + US(NEXT_KBD_POLL_INTERVAL * 1000UL);
+        if (!NEXT_KBD_READ) {
+            // keyboard is not connected
+            compare_at(poll_time);
+            break;
+        }
+        start_steps(query_steps);
+        break;
+    case OUT:
+        if (*steps) {
+            if (*steps & 0x80) out_hi(); else out_lo();
+            step_time += US(NEXT_KBD_TIMING * (uint16_t)(*steps & 0x7F));
+            steps++;
+            compare_at(step_time);
+        } else if (steps == query_steps + sizeof(query_steps) - 1) {
+            out_hi();
+            state = WAIT;
+            NEXT_KBD_INT_ON();
+            compare_at(TCNT1 + US(NEXT_KBD_RESP_TIMEOUT * 1000UL));
+        } else {
+            out_hi();
+            next_command();
+        }
+        break;
+    case WAIT:
+        // no response
+        NEXT_KBD_INT_OFF();
+        next_kbd_error = 1;
+        start_steps(reset_steps);
+        break;
+    case FRAME:
+        // rest of frame is in level after last edge
+        if (NEXT_KBD_READ) {
+            for (; rx_bits < BITS; rx_bits++) rx_data |= ((uint32_t)1 << rx_bits);
+        }
+        frame_done();
+        break;
+    }
+}
+
+/* Keyboard Out pin: edges of response */
+ISR(NEXT_KBD_INT_VECT)
+{
+    uint16_t t = TCNT1;
+    bool level = NEXT_KBD_READ;
+
+    if (state == WAIT) {
+        if (level) return;
+        // bit 0 starts with falling edge
+        state = FRAME;
+        rx_data = 0;
+        rx_bits = 0;
+    } else if (state == FRAME) {
+        // bits since previous edge were in other level
+        uint8_t n = ((uint16_t)(t - rx_edge) * 2 + CELL2/2) / CELL2;
+        for (; n && rx_bits < BITS; n--, rx_bits++) {
+            if (!level) rx_data |= ((uint32_t)1 << rx_bits);
+        }
+        if (rx_bits >= BITS) {
+            frame_done();
+            return;
+        }
+    } else {
+        return;
+    }
+    rx_edge = t;
+    next_kbd_error = 0;
+    compare_at(t + (BITS - rx_bits) * CELL + CELL/2);
+}
+
+
+void next_kbd_init(void)
+{
+    out_hi();
+    NEXT_KBD_IN_DDR   &= ~(1<<NEXT_KBD_IN_BIT);   // KBD_IN  to input
+    NEXT_KBD_IN_PORT  |=  (1<<NEXT_KBD_IN_BIT);   // KBD_IN  pull up
+
+    NEXT_KBD_INT_INIT();
+    NEXT_KBD_INT_OFF();
+
+    // Timer1: normal mode, F_CPU/64
+    TCCR1A = 0;
+    TCCR1B = (1<<CS11) | (1<<CS10);
+    poll_time = TCNT1;
+    start_steps(init_steps);
+    TIMSK1 |= (1<<OCIE1A);
+}
+
+void next_kbd_set_leds(bool left, bool right)
+{
+    led_command = 0x80 | (left ? 0x02 : 0) | (right ? 0x01 : 0);
+}
+
+uint32_t next_kbd_recv(void)
+{
+    if (queue_head == queue_tail) return 0;
+    uint32_t data = queue[queue_tail];
+    queue_tail = (queue_tail + 1) % NEXT_KBD_QUEUE_SIZE;
+    return data;
+}
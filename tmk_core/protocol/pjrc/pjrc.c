@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "usb_keyboard.h"
 #include "usb_mouse.h"
 #include "usb_extra.h"
+#include "host.h"
 #include "host_driver.h"
 #include "pjrc.h"
 
@@ -51,13 +52,17 @@ static uint8_t keyboard_leds(void) {
 
 static void send_keyboard(report_keyboard_t *report)
 {
-    usb_keyboard_send_report(report);
+    if (usb_keyboard_send_report(report)) {
+        host_keyboard_unsent();
+    }
 }
 
 static void send_mouse(report_mouse_t *report)
 {
 #ifdef MOUSE_ENABLE
-    usb_mouse_send(report->x, report->y, report->v, report->h, report->buttons);
+    if (usb_mouse_send(report->x, report->y, report->v, report->h, report->buttons)) {
+        host_mouse_unsent();
+    }
 #endif
 }
 
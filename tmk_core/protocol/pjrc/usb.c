@@ -930,11 +930,8 @@ ISR(USB_COM_vect)
 					return;
 				}
 				if (bRequest == HID_SET_PROTOCOL) {
-					keyboard_protocol = wValue;
-#ifdef NKRO_ENABLE
-                                        keyboard_nkro = !!keyboard_protocol;
-#endif
-                                        clear_keyboard();
+					// keyboard_task() switches report format with keys held
+					keyboard_protocol = !!wValue;
 					//usb_wait_in_ready();
 					usb_send_in();
 					return;
@@ -45,6 +45,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "ps2.h"
 #include "ps2_io.h"
 #include "print.h"
+#include "ring_buffer.h"
 
 
 #define WAIT(stat, us, err) do { \
@@ -58,10 +59,11 @@ POSSIBILITY OF SUCH DAMAGE.
 uint8_t ps2_error = PS2_ERR_NONE;
 
 
-static inline uint8_t pbuf_dequeue(void);
-static inline void pbuf_enqueue(uint8_t data);
-static inline bool pbuf_has_data(void);
-static inline void pbuf_clear(void);
+/* Ring buffer to store scan codes from keyboard */
+#ifndef PBUF_SIZE
+#define PBUF_SIZE 32
+#endif
+RBUF_DEFINE(pbuf, PBUF_SIZE);
 
 
 void ps2_host_init(void)
@@ -135,17 +137,20 @@ uint8_t ps2_host_recv_response(void)
 {
     // Command may take 25ms/20ms at most([5]p.46, [3]p.21)
     uint8_t retry = 25;
-    while (retry-- && !pbuf_has_data()) {
+    while (retry-- && !rbuf_has_data(&pbuf)) {
         _delay_ms(1);
     }
-    return pbuf_dequeue();
+    return rbuf_dequeue(&pbuf);
 }
 
 uint8_t ps2_host_recv(void)
 {
-    if (pbuf_has_data()) {
+    if (rbuf_overflow(&pbuf)) {
+        print("pbuf: full\n");
+    }
+    if (rbuf_has_data(&pbuf)) {
         ps2_error = PS2_ERR_NONE;
-        return pbuf_dequeue();
+        return rbuf_dequeue(&pbuf);
     } else {
         ps2_error = PS2_ERR_NODATA;
         return 0;
@@ -158,7 +163,7 @@ ISR(PS2_USART_RX_VECT)
     uint8_t error = PS2_USART_ERROR;    // USART error should be read before data
     uint8_t data = PS2_USART_RX_DATA;
     if (!error) {
-        pbuf_enqueue(data);
+        rbuf_enqueue(&pbuf, data);
     } else {
         xprintf("PS2 USART error: %02X data: %02X\n", error, data);
     }
@@ -170,54 +175,3 @@ void ps2_host_set_led(uint8_t led)
     ps2_host_send(0xED);
     ps2_host_send(led);
 }
-
-
-/*--------------------------------------------------------------------
- * Ring buffer to store scan codes from keyboard
- *------------------------------------------------------------------*/
-#define PBUF_SIZE 32
-static uint8_t pbuf[PBUF_SIZE];
-static uint8_t pbuf_head = 0;
-static uint8_t pbuf_tail = 0;
-static inline void pbuf_enqueue(uint8_t data)
-{
-    uint8_t sreg = SREG;
-    cli();
-    uint8_t next = (pbuf_head + 1) % PBUF_SIZE;
-    if (next != pbuf_tail) {
-        pbuf[pbuf_head] = data;
-        pbuf_head = next;
-    } else {
-        print("pbuf: full\n");
-    }
-    SREG = sreg;
-}
-static inline uint8_t pbuf_dequeue(void)
-{
-    uint8_t val = 0;
-
-    uint8_t sreg = SREG;
-    cli();
-    if (pbuf_head != pbuf_tail) {
-        val = pbuf[pbuf_tail];
-        pbuf_tail = (pbuf_tail + 1) % PBUF_SIZE;
-    }
-    SREG = sreg;
-
-    return val;
-}
-static inline bool pbuf_has_data(void)
-{
-    uint8_t sreg = SREG;
-    cli();
-    bool has_data = (pbuf_head != pbuf_tail);
-    SREG = sreg;
-    return has_data;
-}
-static inline void pbuf_clear(void)
-{
-    uint8_t sreg = SREG;
-    cli();
-    pbuf_head = pbuf_tail = 0;
-    SREG = sreg;
-}
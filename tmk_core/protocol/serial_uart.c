@@ -39,18 +39,18 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include "serial.h"
+#include "ring_buffer.h"
+
+
+// RX ring buffer
+RBUF_DEFINE(rbuf, 256);
 
 
 #if defined(SERIAL_UART_RTS_LO) && defined(SERIAL_UART_RTS_HI)
-    // Buffer state
-    //   Empty:           RBUF_SPACE == RBUF_SIZE(head==tail)
-    //   Last 1 space:    RBUF_SPACE == 2
-    //   Full:            RBUF_SPACE == 1(last cell of rbuf be never used.)
-    #define RBUF_SPACE()   (rbuf_head < rbuf_tail ?  (rbuf_tail - rbuf_head) : (RBUF_SIZE - rbuf_head + rbuf_tail))
     // allow to send
-    #define rbuf_check_rts_lo() do { if (RBUF_SPACE() > 2) SERIAL_UART_RTS_LO(); } while (0)
-    // prohibit to send
-    #define rbuf_check_rts_hi() do { if (RBUF_SPACE() <= 2) SERIAL_UART_RTS_HI(); } while (0)
+    #define rbuf_check_rts_lo() do { if (rbuf_space(&rbuf) > 1) SERIAL_UART_RTS_LO(); } while (0)
+    // prohibit to send when only last 1 space is left
+    #define rbuf_check_rts_hi() do { if (rbuf_space(&rbuf) <= 1) SERIAL_UART_RTS_HI(); } while (0)
 #else
     #define rbuf_check_rts_lo()
     #define rbuf_check_rts_hi()
@@ -62,34 +62,24 @@ void serial_init(void)
     SERIAL_UART_INIT();
 }
 
-// RX ring buffer
-#define RBUF_SIZE   256
-static uint8_t rbuf[RBUF_SIZE];
-static uint8_t rbuf_head = 0;
-static uint8_t rbuf_tail = 0;
-
 uint8_t serial_recv(void)
 {
-    uint8_t data = 0;
-    if (rbuf_head == rbuf_tail) {
+    if (!rbuf_has_data(&rbuf)) {
         return 0;
     }
 
-    data = rbuf[rbuf_tail];
-    rbuf_tail = (rbuf_tail + 1) % RBUF_SIZE;
+    uint8_t data = rbuf_dequeue(&rbuf);
     rbuf_check_rts_lo();
     return data;
 }
 
 int16_t serial_recv2(void)
 {
-    uint8_t data = 0;
-    if (rbuf_head == rbuf_tail) {
+    if (!rbuf_has_data(&rbuf)) {
         return -1;
     }
 
-    data = rbuf[rbuf_tail];
-    rbuf_tail = (rbuf_tail + 1) % RBUF_SIZE;
+    uint8_t data = rbuf_dequeue(&rbuf);
     rbuf_check_rts_lo();
     return data;
 }
@@ -103,10 +93,6 @@ void serial_send(uint8_t data)
 // USART RX complete interrupt
 ISR(SERIAL_UART_RXD_VECT)
 {
-    uint8_t next = (rbuf_head + 1) % RBUF_SIZE;
-    if (next != rbuf_tail) {
-        rbuf[rbuf_head] = SERIAL_UART_DATA;
-        rbuf_head = next;
-    }
+    rbuf_enqueue(&rbuf, SERIAL_UART_DATA);
     rbuf_check_rts_hi();
 }
@@ -0,0 +1,87 @@
+/*
+ * Scripted matrix for simulation
+ *
+ * Key states are set by simulator through sim_matrix_set() and become visible
+ * to core at next matrix_scan(), which also advances virtual clock by the
+ * scan period.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "print.h"
+#include "util.h"
+#include "matrix.h"
+#include "sim.h"
+
+
+static matrix_row_t matrix[MATRIX_ROWS];
+static matrix_row_t matrix_next[MATRIX_ROWS];
+
+
+uint8_t matrix_rows(void)
+{
+    return MATRIX_ROWS;
+}
+
+uint8_t matrix_cols(void)
+{
+    return MATRIX_COLS;
+}
+
+void matrix_init(void)
+{
+    sim_matrix_clear();
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+        matrix[i] = 0;
+    }
+}
+
+uint8_t matrix_scan(void)
+{
+    sim_scan_hook();
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+        matrix[i] = matrix_next[i];
+    }
+    return 1;
+}
+
+bool matrix_is_modified(void)
+{
+    return true;
+}
+
+bool matrix_is_on(uint8_t row, uint8_t col)
+{
+    return (matrix[row] & ((matrix_row_t)1<<col));
+}
+
+matrix_row_t matrix_get_row(uint8_t row)
+{
+    return matrix[row];
+}
+
+void matrix_print(void)
+{
+    print("\nr/c 0123456789ABCDEF\n");
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        phex(row); print(": ");
+        pbin_reverse16(matrix_get_row(row));
+        print("\n");
+    }
+}
+
+void sim_matrix_set(uint8_t row, uint8_t col, bool on)
+{
+    if (row >= MATRIX_ROWS || col >= MATRIX_COLS) return;
+    if (on) {
+        matrix_next[row] |= ((matrix_row_t)1<<col);
+    } else {
+        matrix_next[row] &= ~((matrix_row_t)1<<col);
+    }
+}
+
+void sim_matrix_clear(void)
+{
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+        matrix_next[i] = 0;
+    }
+}
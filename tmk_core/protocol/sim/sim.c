@@ -0,0 +1,725 @@
+/*
+ * Host-native simulation of tmk_core
+ *
+ * Replays key event trace through keyboard_task() with scripted matrix and
+ * virtual clock, records reports sent to host driver and measures latency
+ * from key change to report and per-event cost of the action pipeline.
+ *
+ * Trace file format: one event per line, '#' starts comment.
+ *     <time ms> <row> <col> <d|u>
+ *     10.0      0     1     d
+ *     45.5      0     1     u
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#   include <x86intrin.h>
+#   define CYCLES()     __rdtsc()
+#else
+#   define CYCLES()     0
+#endif
+#include "keyboard.h"
+#include "keycode.h"
+#include "action.h"
+#include "action_layer.h"
+#include "host.h"
+#include "host_driver.h"
+#include "report.h"
+#include "timer.h"
+#include "matrix.h"
+#include "led.h"
+#include "util.h"
+#include "latency.h"
+#include "sim.h"
+#include "event_trace.h"
+#ifdef BOOTMAGIC_ENABLE
+#   include "eeconfig.h"
+#   include "eeprom_sim.h"
+#endif
+
+
+uint8_t keyboard_idle = 0;
+uint8_t keyboard_protocol = 1;
+
+/* period of a matrix scan in virtual time(us) */
+static uint32_t scan_us = 1000;
+/* print every report */
+static bool verbose = true;
+
+
+/*******************************************************************************
+ * Trace
+ ******************************************************************************/
+typedef struct {
+    uint64_t time;          /* us */
+    keypos_t key;
+    bool     pressed;
+    int8_t   protocol;      /* SET_PROTOCOL from host, -1 for key event */
+    bool     applied;
+    bool     delivered;
+    uint8_t  code;          /* keycode expected in report, KC_NO when untracked */
+    uint64_t applied_at;
+} sim_event_t;
+
+static sim_event_t *trace = NULL;
+static uint32_t trace_len = 0;
+static uint32_t trace_cap = 0;
+static uint32_t trace_next = 0;         /* next event to apply */
+static uint32_t trace_pending = 0;      /* first event not delivered yet */
+
+static bool trace_add(uint64_t time, uint8_t row, uint8_t col, bool pressed, int8_t protocol)
+{
+    if (trace_len == trace_cap) {
+        uint32_t cap = trace_cap ? trace_cap * 2 : 256;
+        sim_event_t *t = realloc(trace, cap * sizeof(sim_event_t));
+        if (!t) return false;
+        trace = t;
+        trace_cap = cap;
+    }
+    trace[trace_len++] = (sim_event_t){
+        .time = time,
+        .key = (keypos_t){ .row = row, .col = col },
+        .pressed = pressed,
+        .protocol = protocol
+    };
+    return true;
+}
+
+/* report changes expected by trace, from event_trace_dump() */
+typedef struct {
+    uint64_t time;          /* us */
+    uint8_t  type;          /* EVENT_TRACE_REPORT_* | EVENT_TRACE_PRESSED */
+    uint8_t  code;
+} sim_expect_t;
+
+static sim_expect_t *expect = NULL;
+static uint32_t expect_len = 0;
+static uint32_t expect_cap = 0;
+
+static bool expect_add(uint64_t time, uint8_t type, uint8_t code)
+{
+    if (expect_len == expect_cap) {
+        uint32_t cap = expect_cap ? expect_cap * 2 : 256;
+        sim_expect_t *e = realloc(expect, cap * sizeof(sim_expect_t));
+        if (!e) return false;
+        expect = e;
+        expect_cap = cap;
+    }
+    expect[expect_len++] = (sim_expect_t){ .time = time, .type = type, .code = code };
+    return true;
+}
+
+static bool trace_load(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        perror(path);
+        return false;
+    }
+
+    char line[128];
+    uint32_t lineno = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        lineno++;
+        char *p = strchr(line, '#');
+        if (p) *p = '\0';
+
+        double ms;
+        unsigned row, col;
+        char ud;
+        if (sscanf(line, "%lf p %u", &ms, &row) == 2 && row <= 1) {
+            if (!trace_add((uint64_t)(ms * 1000), 0, 0, false, row)) {
+                fclose(fp);
+                return false;
+            }
+            continue;
+        }
+        /* row is keycode or mods */
+        if (sscanf(line, "%lf k %x %c", &ms, &row, &ud) == 3 && row <= 0xFF && (ud == 'd' || ud == 'u')) {
+            if (!expect_add((uint64_t)(ms * 1000),
+                            EVENT_TRACE_REPORT_KEY | (ud == 'd' ? EVENT_TRACE_PRESSED : 0), row)) {
+                fclose(fp);
+                return false;
+            }
+            continue;
+        }
+        if (sscanf(line, "%lf m %x", &ms, &row) == 2 && row <= 0xFF) {
+            if (!expect_add((uint64_t)(ms * 1000), EVENT_TRACE_REPORT_MODS, row)) {
+                fclose(fp);
+                return false;
+            }
+            continue;
+        }
+        int n = sscanf(line, "%lf %u %u %c", &ms, &row, &col, &ud);
+        if (n <= 0) continue;
+        if (n != 4 || (ud != 'd' && ud != 'u') || row >= MATRIX_ROWS || col >= MATRIX_COLS) {
+            fprintf(stderr, "%s:%u: invalid event\n", path, lineno);
+            fclose(fp);
+            return false;
+        }
+        if (!trace_add((uint64_t)(ms * 1000), row, col, ud == 'd', -1)) {
+            fclose(fp);
+            return false;
+        }
+    }
+    fclose(fp);
+    return true;
+}
+
+/* repeat trace n times with a gap of idle time between */
+static bool trace_repeat(uint32_t n, uint32_t gap_us)
+{
+    if (!trace_len) return true;
+
+    uint32_t len = trace_len;
+    uint64_t period = trace[len - 1].time + gap_us;
+    for (uint32_t i = 1; i < n; i++) {
+        for (uint32_t j = 0; j < len; j++) {
+            if (!trace_add(trace[j].time + period * i, trace[j].key.row, trace[j].key.col,
+                           trace[j].pressed, trace[j].protocol)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+/*******************************************************************************
+ * Statistics
+ ******************************************************************************/
+static struct {
+    uint32_t keyboard_reports;
+    uint32_t mouse_reports;
+    uint32_t system_reports;
+    uint32_t consumer_reports;
+
+    /* key change to report(us) */
+    uint32_t latency_count;
+    uint64_t latency_sum;
+    uint64_t latency_min;
+    uint64_t latency_max;
+    /* latency of last key of events which happen at same time */
+    uint32_t chord_count;
+    uint64_t chord_sum;
+    uint64_t chord_max;
+
+    /* keyboard_task() cost */
+    uint32_t event_tasks;
+    uint32_t idle_tasks;
+    uint64_t event_cycles;
+    uint64_t idle_cycles;
+    uint64_t event_ns;
+    uint64_t idle_ns;
+} stats = { .latency_min = UINT64_MAX };
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void stats_chord(uint32_t i)
+{
+    uint32_t first = i, last = i;
+    while (first > 0 && trace[first - 1].time == trace[i].time) first--;
+    while (last + 1 < trace_len && trace[last + 1].time == trace[i].time) last++;
+    if (first == last) return;
+
+    uint64_t max = 0;
+    for (uint32_t j = first; j <= last; j++) {
+        if (!trace[j].delivered) return;
+        if (trace[j].code == KC_NO) continue;
+        uint64_t latency = trace[j].applied_at - trace[j].time;
+        if (latency > max) max = latency;
+    }
+    stats.chord_count++;
+    stats.chord_sum += max;
+    if (max > stats.chord_max) stats.chord_max = max;
+}
+
+#ifdef NKRO_ENABLE
+/* last report of each interface, host keeps keys of both */
+static report_keyboard_t host_boot;
+static report_keyboard_t host_nkro;
+
+static uint8_t host_key_count(report_keyboard_t *report, uint8_t len)
+{
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < len; i++) {
+        n += bitpop(report->raw[i]);
+    }
+    return n;
+}
+#endif
+
+static void stats_print(void)
+{
+    printf("\n---- statistics ----\n");
+    printf("scan period:      %u us\n", scan_us);
+    printf("events:           %u\n", trace_len);
+    printf("reports:          keyboard %u, mouse %u, system %u, consumer %u\n",
+           stats.keyboard_reports, stats.mouse_reports, stats.system_reports, stats.consumer_reports);
+    printf("suppressed:       keyboard %u, mouse %u\n",
+           host_report_stats.keyboard.suppressed, host_report_stats.mouse.suppressed);
+    if (stats.latency_count) {
+        printf("latency(us):      min %llu, avg %llu, max %llu (%u events)\n",
+               (unsigned long long)stats.latency_min,
+               (unsigned long long)(stats.latency_sum / stats.latency_count),
+               (unsigned long long)stats.latency_max, stats.latency_count);
+    }
+    if (stats.chord_count) {
+        printf("chord latency(us): avg %llu, max %llu (%u chords)\n",
+               (unsigned long long)(stats.chord_sum / stats.chord_count),
+               (unsigned long long)stats.chord_max, stats.chord_count);
+    }
+    if (stats.event_tasks) {
+        printf("event task:       %u calls, %llu cycles/event, %llu ns/event, %.0f events/s\n",
+               stats.event_tasks,
+               (unsigned long long)(stats.event_cycles / trace_len),
+               (unsigned long long)(stats.event_ns / trace_len),
+               stats.event_ns ? trace_len * 1e9 / stats.event_ns : 0.0);
+    }
+    if (stats.idle_tasks) {
+        printf("idle task:        %u calls, %llu cycles/call, %llu ns/call\n",
+               stats.idle_tasks,
+               (unsigned long long)(stats.idle_cycles / stats.idle_tasks),
+               (unsigned long long)(stats.idle_ns / stats.idle_tasks));
+    }
+#ifdef NKRO_ENABLE
+    /* keys left on host, all should be released at end of trace */
+    printf("host keys:        boot %u, nkro %u\n",
+           host_key_count(&host_boot, 8), host_key_count(&host_nkro, KEYBOARD_REPORT_SIZE));
+#endif
+#ifdef KEYBOARD_IDLE_TIMEOUT
+    printf("scans/s:          active %u, idle %u\n",
+           keyboard_scan_rate(KEYBOARD_SCAN_ACTIVE), keyboard_scan_rate(KEYBOARD_SCAN_IDLE));
+#endif
+}
+
+
+/*******************************************************************************
+ * Replay check
+ ******************************************************************************/
+/* compares report changes recorded by event trace with those of the trace,
+ * from time of the first expected one */
+static void replay_check(void)
+{
+    if (!expect_len) return;
+
+    printf("\n---- replay ----\n");
+#ifdef EVENT_TRACE_ENABLE
+    uint16_t count = event_trace_count();
+    if (count == EVENT_TRACE_SIZE) {
+        printf("event trace is full, increase EVENT_TRACE_SIZE\n");
+    }
+
+    uint32_t n = 0, matched = 0, extra = 0;
+    bool mismatch = false;
+    uint64_t t = count ? event_trace_get(0).time : 0;
+    uint16_t prev = t;
+    for (uint16_t i = 0; i < count; i++) {
+        event_trace_t r = event_trace_get(i);
+        t += (uint16_t)(r.time - prev);
+        prev = r.time;
+        if ((r.type & ~EVENT_TRACE_PRESSED) == EVENT_TRACE_KEY) continue;
+        if (t * 1000 < expect[0].time) continue;
+
+        if (n == expect_len) {
+            extra++;
+            continue;
+        }
+        sim_expect_t *e = &expect[n++];
+        if (e->type == r.type && e->code == r.a) {
+            matched++;
+        } else if (!mismatch) {
+            mismatch = true;
+            printf("first mismatch: expected %llu %c %02X %c, got %llu %c %02X %c\n",
+                   (unsigned long long)(e->time / 1000),
+                   (e->type & ~EVENT_TRACE_PRESSED) == EVENT_TRACE_REPORT_MODS ? 'm' : 'k',
+                   e->code, (e->type & EVENT_TRACE_PRESSED) ? 'd' : 'u',
+                   (unsigned long long)t,
+                   (r.type & ~EVENT_TRACE_PRESSED) == EVENT_TRACE_REPORT_MODS ? 'm' : 'k',
+                   r.a, (r.type & EVENT_TRACE_PRESSED) ? 'd' : 'u');
+        }
+    }
+    printf("report changes:   %u of %u match, %u missing, %u extra\n",
+           matched, expect_len, expect_len - n, extra);
+#else
+    printf("build with EVENT_TRACE_ENABLE to check %u report changes\n", expect_len);
+#endif
+}
+
+
+/*******************************************************************************
+ * Scan hook
+ ******************************************************************************/
+/* key events applied and reports sent in current keyboard_task() */
+static uint32_t task_activity = 0;
+
+/* keycode which must appear in report when key is pressed */
+static uint8_t event_code(keypos_t key)
+{
+    action_t action = layer_switch_get_action(key);
+    switch (action.kind.id) {
+        case ACT_LMODS:
+        case ACT_RMODS:
+            if (action.key.mods == 0 && (IS_KEY(action.key.code) || IS_MOD(action.key.code))) {
+                return action.key.code;
+            }
+            break;
+    }
+    return KC_NO;
+}
+
+void sim_scan_hook(void)
+{
+    timer_sim_advance_us(scan_us);
+
+    uint64_t now = timer_sim_read_us();
+    while (trace_next < trace_len && trace[trace_next].time <= now) {
+        sim_event_t *e = &trace[trace_next++];
+        e->applied = true;
+        if (e->protocol >= 0) {
+            keyboard_protocol = e->protocol;
+            e->code = KC_NO;
+            e->delivered = true;
+            continue;
+        }
+        sim_matrix_set(e->key.row, e->key.col, e->pressed);
+        e->code = event_code(e->key);
+        if (e->code == KC_NO) {
+            e->delivered = true;
+        }
+        task_activity++;
+    }
+}
+
+
+/*******************************************************************************
+ * Host driver
+ ******************************************************************************/
+static uint8_t keyboard_leds(void);
+static void send_keyboard(report_keyboard_t *report);
+static void send_mouse(report_mouse_t *report);
+static void send_system(uint16_t data);
+static void send_consumer(uint16_t data);
+host_driver_t sim_driver = {
+    keyboard_leds,
+    send_keyboard,
+    send_mouse,
+    send_system,
+    send_consumer
+};
+
+static uint8_t keyboard_led_stats = 0;
+
+static void print_time(void)
+{
+    uint64_t t = timer_sim_read_us();
+    printf("%8llu.%03llu ", (unsigned long long)(t / 1000), (unsigned long long)(t % 1000));
+}
+
+static bool report_has_code(report_keyboard_t *report, uint8_t code)
+{
+    if (IS_MOD(code)) {
+        return report->mods & MOD_BIT(code);
+    }
+#ifdef NKRO_ENABLE
+    if (keyboard_nkro) {
+        return ((code>>3) < KEYBOARD_REPORT_BITS) && (report->nkro.bits[code>>3] & (1<<(code&7)));
+    }
+#endif
+    for (uint8_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
+        if (report->keys[i] == code) return true;
+    }
+    return false;
+}
+
+static uint8_t keyboard_leds(void)
+{
+    return keyboard_led_stats;
+}
+
+static void send_keyboard(report_keyboard_t *report)
+{
+    stats.keyboard_reports++;
+    task_activity++;
+    latency_send();
+    if (verbose) {
+        print_time();
+#ifdef NKRO_ENABLE
+        printf(keyboard_nkro ? "nkro:" : "keyboard:");
+#else
+        printf("keyboard:");
+#endif
+        for (uint8_t i = 0; i < KEYBOARD_REPORT_SIZE; i++) {
+            printf(" %02X", report->raw[i]);
+        }
+        printf("\n");
+    }
+#ifdef NKRO_ENABLE
+    if (keyboard_nkro) {
+        host_nkro = *report;
+    } else {
+        host_boot = *report;
+    }
+#endif
+
+    /* events whose key state is now reflected in report are delivered */
+    uint64_t now = timer_sim_read_us();
+    for (uint32_t i = trace_pending; i < trace_next; i++) {
+        sim_event_t *e = &trace[i];
+        if (e->delivered) continue;
+        if (report_has_code(report, e->code) != e->pressed) continue;
+
+        e->delivered = true;
+        e->applied_at = now;
+        uint64_t latency = now - e->time;
+        stats.latency_count++;
+        stats.latency_sum += latency;
+        if (latency < stats.latency_min) stats.latency_min = latency;
+        if (latency > stats.latency_max) stats.latency_max = latency;
+        stats_chord(i);
+    }
+    while (trace_pending < trace_next && trace[trace_pending].delivered) {
+        trace_pending++;
+    }
+}
+
+static void send_mouse(report_mouse_t *report)
+{
+    stats.mouse_reports++;
+    task_activity++;
+    if (verbose) {
+        print_time();
+        printf("mouse: %02X %d %d %d %d\n", report->buttons, report->x, report->y, report->v, report->h);
+    }
+}
+
+static void send_system(uint16_t data)
+{
+    stats.system_reports++;
+    task_activity++;
+    if (verbose) {
+        print_time();
+        printf("system: %04X\n", data);
+    }
+}
+
+static void send_consumer(uint16_t data)
+{
+    stats.consumer_reports++;
+    task_activity++;
+    if (verbose) {
+        print_time();
+        printf("consumer: %04X\n", data);
+    }
+}
+
+__attribute__ ((weak))
+void led_set(uint8_t usb_led)
+{
+}
+
+
+/*******************************************************************************
+ * Run
+ ******************************************************************************/
+static void run_trace(uint32_t tail_ms)
+{
+    uint64_t end = (trace_len ? trace[trace_len - 1].time : 0) + (uint64_t)tail_ms * 1000;
+
+    while (trace_next < trace_len || timer_sim_read_us() < end) {
+        task_activity = 0;
+        uint64_t ns = now_ns();
+        uint64_t cycles = CYCLES();
+
+        keyboard_task();
+
+        cycles = CYCLES() - cycles;
+        ns = now_ns() - ns;
+        if (task_activity) {
+            stats.event_tasks++;
+            stats.event_cycles += cycles;
+            stats.event_ns += ns;
+        } else {
+            stats.idle_tasks++;
+            stats.idle_cycles += cycles;
+            stats.idle_ns += ns;
+        }
+    }
+}
+
+/* cost of layer_switch_get_action() with 1, 4 and 16 active layers */
+#ifndef SIM_KEYMAP_LAYERS
+#define SIM_KEYMAP_LAYERS   1
+#endif
+static void bench_layer(uint32_t loops)
+{
+    static const uint8_t active[] = { 1, 4, 16 };
+
+    /* layer change clears keyboard report */
+    verbose = false;
+    printf("---- layer_switch_get_action() ----\n");
+    for (uint8_t i = 0; i < sizeof(active); i++) {
+        uint8_t n = active[i];
+        if (n > SIM_KEYMAP_LAYERS) {
+            printf("%2u layers: skipped(keymap has %u layers)\n", n, SIM_KEYMAP_LAYERS);
+            continue;
+        }
+        default_layer_set(1UL<<0);
+        layer_clear();
+        layer_or(((n < 32 ? (1UL<<n) : 0) - 1) & ~1UL);
+
+        uint32_t sum = 0;
+        uint64_t ns = now_ns();
+        uint64_t cycles = CYCLES();
+        for (uint32_t l = 0; l < loops; l++) {
+            for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+                for (uint8_t c = 0; c < MATRIX_COLS; c++) {
+                    sum += layer_switch_get_action((keypos_t){ .row = r, .col = c }).code;
+                }
+            }
+        }
+        cycles = CYCLES() - cycles;
+        ns = now_ns() - ns;
+        uint64_t lookups = (uint64_t)loops * MATRIX_ROWS * MATRIX_COLS;
+        printf("%2u layers: %llu cycles/lookup, %.1f ns/lookup (sum %08X)\n", n,
+               (unsigned long long)(cycles / lookups), (double)ns / lookups, sum);
+    }
+    layer_clear();
+}
+
+#ifdef BOOTMAGIC_ENABLE
+/* eeprom writes for bursts of settings changes: 8 changes 200ms apart then
+ * 10s idle, like stepping backlight level or toggling keymap options */
+static uint64_t run_for(uint32_t ms)
+{
+    uint64_t end = timer_sim_read_us() + (uint64_t)ms * 1000;
+    uint64_t task_max = 0;
+    while (timer_sim_read_us() < end) {
+        uint64_t t = timer_sim_read_us();
+        keyboard_task();
+        t = timer_sim_read_us() - t;
+        if (t > task_max) task_max = t;
+    }
+    return task_max;
+}
+
+static void bench_eeconfig(uint32_t bursts)
+{
+    verbose = false;
+    run_for(EECONFIG_COMMIT_DELAY + 1000);
+    uint32_t writes = eeprom_sim_writes();
+    uint32_t wear = eeprom_sim_wear_max();
+    uint64_t wait = eeprom_sim_wait_us();
+    uint64_t task_max = 0;
+    uint32_t changes = 0;
+    uint8_t val = eeconfig_read_keymap();
+
+    for (uint32_t b = 0; b < bursts; b++) {
+        for (uint8_t i = 0; i < 8; i++) {
+            eeconfig_write_keymap(++val);
+            changes++;
+            uint64_t t = run_for(200);
+            if (t > task_max) task_max = t;
+        }
+        uint64_t t = run_for(EECONFIG_COMMIT_DELAY + 10000);
+        if (t > task_max) task_max = t;
+    }
+
+    printf("---- eeconfig: %u slots, commit delay %u ms ----\n",
+           EECONFIG_SLOTS, EECONFIG_COMMIT_DELAY);
+    printf("changes:        %u\n", changes);
+    printf("bytes written:  %u\n", eeprom_sim_writes() - writes);
+    printf("max byte wear:  %u\n", eeprom_sim_wear_max() - wear);
+    printf("eeprom wait:    %llu us\n", (unsigned long long)(eeprom_sim_wait_us() - wait));
+    printf("task max:       %llu us\n", (unsigned long long)task_max);
+
+    /* reload as after power cycle */
+    eeconfig_load();
+    printf("reload:         %s\n", eeconfig_read_keymap() == val ? "ok" : "NG");
+}
+#endif
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+        "usage: %s [-q] [-d] [-s scan_us] [-n repeat] [-t tail_ms] trace\n"
+        "       %s -L [-n loops]\n"
+        "       %s -E [-n bursts]\n"
+        "  -q          don't print reports, only statistics\n"
+        "  -d          dump event trace to stderr(EVENT_TRACE_ENABLE, CONSOLE_ENABLE)\n"
+        "  -s scan_us  virtual duration of a matrix scan(default 1000)\n"
+        "  -n repeat   replay trace n times\n"
+        "  -t tail_ms  keep running after last event(default 1000)\n"
+        "  -L          benchmark layer_switch_get_action()\n"
+        "  -E          benchmark eeprom writes of eeconfig(BOOTMAGIC_ENABLE)\n",
+        name, name, name);
+}
+
+
+int main(int argc, char **argv)
+{
+    uint32_t repeat = 1;
+    uint32_t tail_ms = 1000;
+    bool layer_bench = false;
+    bool eeconfig_bench = false;
+    bool dump = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "qds:n:t:LE")) != -1) {
+        switch (opt) {
+            case 'q': verbose = false; break;
+            case 'd': dump = true; break;
+            case 's': scan_us = strtoul(optarg, NULL, 0); break;
+            case 'n': repeat = strtoul(optarg, NULL, 0); break;
+            case 't': tail_ms = strtoul(optarg, NULL, 0); break;
+            case 'L': layer_bench = true; break;
+            case 'E': eeconfig_bench = true; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    keyboard_setup();
+    keyboard_init();
+    host_set_driver(&sim_driver);
+
+    if (layer_bench) {
+        bench_layer(repeat > 1 ? repeat : 10000);
+        return 0;
+    }
+
+    if (eeconfig_bench) {
+#ifdef BOOTMAGIC_ENABLE
+        bench_eeconfig(repeat > 1 ? repeat : 100);
+        return 0;
+#else
+        fprintf(stderr, "-E: build with BOOTMAGIC_ENABLE\n");
+        return 1;
+#endif
+    }
+
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (!trace_load(argv[optind])) return 1;
+    if (!trace_repeat(repeat, tail_ms * 1000)) return 1;
+
+    run_trace(tail_ms);
+    stats_print();
+    replay_check();
+    if (dump) event_trace_dump();
+    latency_print();
+    return 0;
+}
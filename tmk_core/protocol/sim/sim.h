@@ -0,0 +1,26 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "host_driver.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern host_driver_t sim_driver;
+
+/* virtual matrix: state seen by next matrix_scan() */
+void sim_matrix_set(uint8_t row, uint8_t col, bool on);
+void sim_matrix_clear(void);
+
+/* called at every matrix_scan() to advance virtual clock and apply trace */
+void sim_scan_hook(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
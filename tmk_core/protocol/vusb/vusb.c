@@ -94,6 +94,7 @@ static void send_keyboard(report_keyboard_t *report)
         kbuf_head = next;
     } else {
         debug("kbuf: full\n");
+        host_keyboard_unsent();
     }
 
     // NOTE: send key strokes of Macro
@@ -115,6 +116,8 @@ static void send_mouse(report_mouse_t *report)
     };
     if (usbInterruptIsReady3()) {
         usbSetInterrupt3((void *)&r, sizeof(vusb_mouse_report_t));
+    } else {
+        host_mouse_unsent();
     }
 }
 
@@ -1,53 +1,95 @@
 #ifndef RING_BUFFER_H
 #define RING_BUFFER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
 /*--------------------------------------------------------------------
- * Ring buffer to store scan codes from keyboard
+ * Single-producer single-consumer ring buffer of bytes
+ *
+ * Producer(usually ISR) only enqueues and consumer only dequeues. Size is
+ * power of two up to 256 so that index is a byte, which is read and written
+ * atomically on AVR. Neither side needs cli().
+ * One slot is kept empty to tell full from empty.
+ *
+ *     RBUF_DEFINE(pbuf, 32);
+ *     ISR:  rbuf_enqueue(&pbuf, data);
+ *     main: if (rbuf_has_data(&pbuf)) data = rbuf_dequeue(&pbuf);
  *------------------------------------------------------------------*/
-#define RBUF_SIZE 32
-static uint8_t rbuf[RBUF_SIZE];
-static uint8_t rbuf_head = 0;
-static uint8_t rbuf_tail = 0;
-static inline void rbuf_enqueue(uint8_t data)
+typedef struct {
+    uint8_t *buf;
+    uint8_t mask;
+    volatile uint8_t head;      /* written by producer */
+    volatile uint8_t tail;      /* written by consumer */
+    volatile uint8_t overflow;  /* data lost when full, written by producer */
+    uint8_t overflow_seen;      /* written by consumer */
+} rbuf_t;
+
+#define RBUF_DEFINE(name, size) \
+    typedef char name##_size_check[((size) & ((size) - 1)) == 0 && (size) <= 256 ? 1 : -1]; \
+    static uint8_t name##_data[(size)]; \
+    static rbuf_t name = { .buf = name##_data, .mask = (size) - 1 }
+
+/* keep compiler from reordering data access across index update */
+#define RBUF_BARRIER()  __asm__ __volatile__ ("" ::: "memory")
+
+
+/* producer: false when buffer is full and data is lost */
+static inline bool rbuf_enqueue(rbuf_t *rb, uint8_t data)
 {
-    uint8_t sreg = SREG;
-    cli();
-    uint8_t next = (rbuf_head + 1) % RBUF_SIZE;
-    if (next != rbuf_tail) {
-        rbuf[rbuf_head] = data;
-        rbuf_head = next;
-    } else {
-        print("rbuf: full\n");
+    uint8_t head = rb->head;
+    uint8_t next = (head + 1) & rb->mask;
+    if (next == rb->tail) {
+        rb->overflow++;
+        return false;
     }
-    SREG = sreg;
+    rb->buf[head] = data;
+    RBUF_BARRIER();
+    rb->head = next;
+    return true;
 }
-static inline uint8_t rbuf_dequeue(void)
-{
-    uint8_t val = 0;
 
-    uint8_t sreg = SREG;
-    cli();
-    if (rbuf_head != rbuf_tail) {
-        val = rbuf[rbuf_tail];
-        rbuf_tail = (rbuf_tail + 1) % RBUF_SIZE;
+/* consumer: 0 when buffer is empty */
+static inline uint8_t rbuf_dequeue(rbuf_t *rb)
+{
+    uint8_t tail = rb->tail;
+    if (rb->head == tail) {
+        return 0;
     }
-    SREG = sreg;
+    uint8_t data = rb->buf[tail];
+    RBUF_BARRIER();
+    rb->tail = (tail + 1) & rb->mask;
+    return data;
+}
 
-    return val;
+static inline bool rbuf_has_data(rbuf_t *rb)
+{
+    return rb->head != rb->tail;
 }
-static inline bool rbuf_has_data(void)
+
+static inline uint8_t rbuf_count(rbuf_t *rb)
+{
+    return (rb->head - rb->tail) & rb->mask;
+}
+
+/* number of bytes which can be enqueued */
+static inline uint8_t rbuf_space(rbuf_t *rb)
 {
-    uint8_t sreg = SREG;
-    cli();
-    bool has_data = (rbuf_head != rbuf_tail);
-    SREG = sreg;
-    return has_data;
+    return rb->mask - rbuf_count(rb);
 }
-static inline void rbuf_clear(void)
+
+/* consumer: discard all data */
+static inline void rbuf_clear(rbuf_t *rb)
+{
+    rb->tail = rb->head;
+}
+
+/* consumer: number of bytes lost since last call, to report out of ISR */
+static inline uint8_t rbuf_overflow(rbuf_t *rb)
 {
-    uint8_t sreg = SREG;
-    cli();
-    rbuf_head = rbuf_tail = 0;
-    SREG = sreg;
+    uint8_t n = rb->overflow - rb->overflow_seen;
+    rb->overflow_seen += n;
+    return n;
 }
 
 #endif  /* RING_BUFFER_H */
@@ -0,0 +1 @@
+/* empty, lets keymap_pack include config.h which includes this on host */
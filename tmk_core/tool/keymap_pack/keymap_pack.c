@@ -0,0 +1,116 @@
+/*
+ * Converts keymaps[] of a keymap source into packed keymap of
+ * common/keymap_packed.h and writes it to stdout as C source, size of each
+ * layer is reported to stderr.
+ *
+ * Keymap source is compiled in with host cc, see keymap_pack.mk:
+ *     cc -DKEYMAP_PACK -include config.h -include keymap.c keymap_pack.c
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include "keymap_packed.h"
+
+#ifndef KEYMAP_PACK_SRC
+#   define KEYMAP_PACK_SRC  "keymap"
+#endif
+
+#define LAYERS      (sizeof(keymaps) / sizeof(keymaps[0]))
+
+static uint8_t fill[LAYERS];
+static uint16_t base[LAYERS];
+static uint8_t rows[LAYERS][MATRIX_ROWS][KEYMAP_PACKED_ROW_SIZE];
+static uint8_t codes[LAYERS * MATRIX_ROWS * MATRIX_COLS];
+static unsigned ncodes = 0;
+
+
+/* most common keycode of layer */
+static uint8_t layer_fill(unsigned layer)
+{
+    unsigned count[256] = {};
+    uint8_t max = KC_TRNS;
+    for (unsigned r = 0; r < MATRIX_ROWS; r++) {
+        for (unsigned c = 0; c < MATRIX_COLS; c++) {
+            uint8_t code = keymaps[layer][r][c];
+            if (++count[code] > count[max]) max = code;
+        }
+    }
+    return max;
+}
+
+static int pack_layer(unsigned layer)
+{
+    fill[layer] = layer_fill(layer);
+    base[layer] = ncodes;
+    for (unsigned r = 0; r < MATRIX_ROWS; r++) {
+        unsigned offset = ncodes - base[layer];
+        if (offset > 0xFF) {
+            fprintf(stderr, "keymap_pack: layer %u has too many keys to pack\n", layer);
+            return -1;
+        }
+        rows[layer][r][0] = offset;
+        for (unsigned c = 0; c < MATRIX_COLS; c++) {
+            uint8_t code = keymaps[layer][r][c];
+            if (code == fill[layer]) continue;
+            rows[layer][r][1 + c / 8] |= 1 << (c % 8);
+            codes[ncodes++] = code;
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    unsigned total = 0;
+    for (unsigned l = 0; l < LAYERS; l++) {
+        if (pack_layer(l)) return 1;
+
+        unsigned keys = ncodes - base[l];
+        unsigned size = 1 + 2 + MATRIX_ROWS * KEYMAP_PACKED_ROW_SIZE + keys;
+        total += size;
+        fprintf(stderr, "layer %2u: %4u -> %4u bytes (%u keys, fill %02X)\n",
+                l, MATRIX_ROWS * MATRIX_COLS, size, keys, fill[l]);
+    }
+    // and keymap_packed_layers
+    total += 1;
+    fprintf(stderr, "total:    %4u -> %4u bytes\n",
+            (unsigned)(LAYERS * MATRIX_ROWS * MATRIX_COLS), total);
+
+    printf("/* Generated by keymap_pack from %s, don't edit */\n", KEYMAP_PACK_SRC);
+    printf("#include \"keymap_packed.h\"\n\n");
+    printf("const uint8_t keymap_packed_layers PROGMEM = %u;\n\n", (unsigned)LAYERS);
+
+    printf("const uint8_t keymap_packed_fill[] PROGMEM = {");
+    for (unsigned l = 0; l < LAYERS; l++) {
+        printf("%s0x%02X", l ? ", " : " ", fill[l]);
+    }
+    printf(" };\n\n");
+
+    printf("const uint16_t keymap_packed_base[] PROGMEM = {");
+    for (unsigned l = 0; l < LAYERS; l++) {
+        printf("%s%u", l ? ", " : " ", base[l]);
+    }
+    printf(" };\n\n");
+
+    printf("const uint8_t keymap_packed_rows[][MATRIX_ROWS][KEYMAP_PACKED_ROW_SIZE] PROGMEM = {\n");
+    for (unsigned l = 0; l < LAYERS; l++) {
+        printf("    /* %u */\n    {\n", l);
+        for (unsigned r = 0; r < MATRIX_ROWS; r++) {
+            printf("        {");
+            for (unsigned i = 0; i < KEYMAP_PACKED_ROW_SIZE; i++) {
+                printf("%s0x%02X", i ? ", " : " ", rows[l][r][i]);
+            }
+            printf(" },\n");
+        }
+        printf("    },\n");
+    }
+    printf("};\n\n");
+
+    printf("const uint8_t keymap_packed_codes[] PROGMEM = {");
+    for (unsigned i = 0; i < ncodes; i++) {
+        printf("%s0x%02X,", i % 16 ? " " : "\n    ", codes[i]);
+    }
+    // array can't be empty
+    if (!ncodes) printf("\n    0x00,");
+    printf("\n};\n");
+    return 0;
+}
@@ -0,0 +1,38 @@
+# Packed keymap generated from keymaps[] of KEYMAP_PACKED_SRC
+#
+# keymap_pack is built with host cc together with the keymap source and
+# writes $(OBJDIR)/keymap_packed_data.c, which is added to SRC. keymaps[] of
+# the source is left unused and removed by --gc-sections.
+#
+KEYMAP_PACK_DIR = $(TMK_DIR)/tool/keymap_pack
+KEYMAP_PACKED_SRC ?= $(firstword $(SRC))
+KEYMAP_PACKED_DATA = $(OBJDIR)/keymap_packed_data.c
+HOSTCC ?= cc
+
+# rules below must not become default goal of keyboard Makefile
+KEYMAP_PACK_GOAL := $(.DEFAULT_GOAL)
+
+KEYMAP_PACK_FLAGS = \
+	$(OPT_DEFS) \
+	-DKEYMAP_PACK \
+	-DNO_PRINT \
+	-DNO_DEBUG \
+	-DKEYMAP_PACK_SRC=\"$(KEYMAP_PACKED_SRC)\" \
+	-I. \
+	-I$(KEYMAP_PACK_DIR) \
+	-I$(TMK_DIR)/common \
+	-include $(CONFIG_H) \
+	-include $(KEYMAP_PACKED_SRC) \
+	-funsigned-char \
+	-ffunction-sections \
+	-fdata-sections \
+	-Wl,--gc-sections
+
+$(OBJDIR)/keymap_pack: $(KEYMAP_PACK_DIR)/keymap_pack.c $(KEYMAP_PACKED_SRC) $(CONFIG_H)
+	@mkdir -p $(@D)
+	$(HOSTCC) $(KEYMAP_PACK_FLAGS) -o $@ $<
+
+$(KEYMAP_PACKED_DATA): $(OBJDIR)/keymap_pack
+	$< > $@
+
+.DEFAULT_GOAL := $(KEYMAP_PACK_GOAL)
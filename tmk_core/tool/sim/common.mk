@@ -0,0 +1,100 @@
+OBJECTS += \
+	$(OBJDIR)/common/action.o \
+	$(OBJDIR)/common/action_tapping.o \
+	$(OBJDIR)/common/action_macro.o \
+	$(OBJDIR)/common/action_layer.o \
+	$(OBJDIR)/common/action_util.o \
+	$(OBJDIR)/common/host.o \
+	$(OBJDIR)/common/keymap.o \
+	$(OBJDIR)/common/keyboard.o \
+	$(OBJDIR)/common/print.o \
+	$(OBJDIR)/common/debug.o \
+	$(OBJDIR)/common/util.o \
+	$(OBJDIR)/common/debounce.o \
+	$(OBJDIR)/common/sim/suspend.o \
+	$(OBJDIR)/common/sim/timer.o \
+	$(OBJDIR)/common/sim/bootloader.o \
+	$(OBJDIR)/protocol/sim/sim.o \
+	$(OBJDIR)/protocol/sim/matrix.o
+
+INCLUDE_PATHS += \
+	-I$(TMK_DIR)/common \
+	-I$(TMK_DIR)/protocol \
+	-I$(TMK_DIR)/protocol/sim
+
+CC_FLAGS += -include $(CONFIG_H)
+OPT_DEFS += -DPROTOCOL_SIM
+
+
+
+# Option modules
+# eeconfig on emulated eeprom, avr/eeprom.h and util/delay.h from common/sim
+ifdef BOOTMAGIC_ENABLE
+    OBJECTS += $(OBJDIR)/common/bootmagic.o
+    OBJECTS += $(OBJDIR)/common/avr/eeconfig.o
+    OBJECTS += $(OBJDIR)/common/sim/eeprom.o
+    INCLUDE_PATHS += -I$(TMK_DIR)/common/sim
+    OPT_DEFS += -DBOOTMAGIC_ENABLE
+endif
+
+ifdef MOUSEKEY_ENABLE
+    OBJECTS += $(OBJDIR)/common/mousekey.o
+    OPT_DEFS += -DMOUSEKEY_ENABLE
+    OPT_DEFS += -DMOUSE_ENABLE
+endif
+
+ifdef EXTRAKEY_ENABLE
+    OPT_DEFS += -DEXTRAKEY_ENABLE
+endif
+
+ifdef CONSOLE_ENABLE
+    OPT_DEFS += -DCONSOLE_ENABLE
+else
+    OPT_DEFS += -DNO_PRINT
+    OPT_DEFS += -DNO_DEBUG
+endif
+
+ifdef COMMAND_ENABLE
+    $(error Not Supported)
+endif
+
+ifdef NKRO_ENABLE
+    OPT_DEFS += -DNKRO_ENABLE
+endif
+
+ifdef USB_6KRO_ENABLE
+    OPT_DEFS += -DUSB_6KRO_ENABLE
+endif
+
+ifdef SLEEP_LED_ENABLE
+    $(error Not Supported)
+endif
+
+ifdef BACKLIGHT_ENABLE
+    $(error Not Supported)
+endif
+
+ifdef LAYER_CACHE_ENABLE
+    OPT_DEFS += -DLAYER_CACHE_ENABLE
+endif
+
+ifdef LATENCY_ENABLE
+    OBJECTS += $(OBJDIR)/common/latency.o
+    OPT_DEFS += -DLATENCY_ENABLE
+endif
+
+ifdef EVENT_TRACE_ENABLE
+    OBJECTS += $(OBJDIR)/common/event_trace.o
+    OPT_DEFS += -DEVENT_TRACE_ENABLE
+endif
+
+ifdef KEYMAP_PACKED_ENABLE
+    include $(TMK_DIR)/tool/keymap_pack/keymap_pack.mk
+    OBJECTS += $(OBJDIR)/common/keymap_packed.o
+    OBJECTS += $(OBJDIR)/$(KEYMAP_PACKED_DATA:.c=.o)
+    OPT_DEFS += -DKEYMAP_PACKED_ENABLE
+endif
+
+ifdef KEYMAP_SECTION_ENABLE
+    $(error Not Supported)
+endif
@@ -0,0 +1,41 @@
+# Host gcc build of simulator
+
+CC      = gcc
+LD      = gcc
+SIZE    = size
+
+CC_FLAGS += \
+	-c \
+	-g \
+	-fcommon \
+	-funsigned-char \
+	-Wall \
+	-Wstrict-prototypes
+CC_FLAGS += -MMD -MP
+
+LD_FLAGS =
+
+ifeq ($(DEBUG), 1)
+  CC_FLAGS += -DDEBUG -O0
+else
+  CC_FLAGS += -O2
+endif
+
+all: $(OBJDIR)/$(PROJECT)
+
+clean:
+	rm -f $(OBJDIR)/$(PROJECT) $(OBJECTS) $(DEPS)
+	rm -fr $(OBJDIR)
+
+$(OBJDIR)/%.o: %.c
+	mkdir -p $(@D)
+	$(CC) $(CC_FLAGS) $(OPT_DEFS) -std=gnu99 $(INCLUDE_PATHS) -o $@ $<
+
+$(OBJDIR)/$(PROJECT): $(OBJECTS)
+	$(LD) $(LD_FLAGS) -o $@ $^
+
+size:
+	$(SIZE) $(OBJDIR)/$(PROJECT)
+
+DEPS = $(OBJECTS:.o=.d)
+-include $(DEPS)